@@ -0,0 +1,556 @@
+#ifndef AFFINE_HPP
+#define AFFINE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+#include "nwrow.hpp"
+
+namespace stringAlgorithms {
+
+   // Affine gaps (Gotoh, Myers-Miller)
+   //
+   // A gap of k elements scores open + k * extend, both are normally negative and open must not be positive.
+   // Each cell has three scores, H the best alignment of x[0, i) and y[0, j), E the best ending in an insertion
+   // (a move left) and F the best ending in a deletion (a move up)
+   //
+   //    E[i][j] = max(E[i][j-1] + extend, H[i][j-1] + open + extend)
+   //    F[i][j] = max(F[i-1][j] + extend, H[i-1][j] + open + extend)
+   //    H[i][j] = max(H[i-1][j-1] + score(x[i-1], y[j-1]), E[i][j], F[i][j])
+   //
+   // F only needs the row above so it is kept in one row updated in place. E runs along the row like the left moves
+   // of the linear kernel. Since open <= 0, E[i][j] is also the best of H'[i][k] + open + (j - k) * extend for k < j,
+   // where H' is H without E, so the SIMD sweep finds it with the same prefix scan.
+   //
+   // tb is the open score of a deletion at the start of the alignment (column 0 scores tb + i * extend). The
+   // Myers-Miller recursion passes 0 when a deletion carries on from the sub-problem before it.
+
+   template<typename P>
+   P affine_minus_infinity() {
+      return std::numeric_limits<P>::lowest() / 2;
+   }
+
+   // Which score a move came from, kept 2 bits per cell in a traceback_plane next to the nw_move of H
+   // the E bit is set when E[i][j] extends E[i][j-1] and the F bit when F[i][j] extends F[i-1][j]
+
+   enum affine_extend : uint8_t { AFFINE_E_EXTENDS = 1, AFFINE_F_EXTENDS = 2 };
+
+   // gotoh_row_sweep computes one row of H and F from the row above
+   //
+   //    sweep.first_row(top, gaps);
+   //    for each x: sweep(x, column, top, bottom, gaps); swap(top, bottom);
+   //
+   // column is H[i][0] of the new row, gaps holds F. move_row and extend_row, if given, are filled with the
+   // nw_move and affine_extend bits of the row.
+
+   template<typename I, typename F, bool = nw_simd_eligible<I, F>::value>
+   class gotoh_row_sweep {
+   public:
+      typedef typename PP<F, I>::type                       P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+      typedef typename std::remove_reference<F>::type       F_type;
+
+      gotoh_row_sweep(I y_begin, I y_end, F_type &score_function, P open, P extend, std::vector<P> * = nullptr) :
+         y_begin_(y_begin), y_end_(y_end), y_size_(std::distance(y_begin, y_end)), score_function_(score_function), open_(open),
+         extend_(extend) {}
+
+      void first_row(P *top, P *gaps) const {
+         top[0] = 0;
+         gaps[0] = affine_minus_infinity<P>();
+         for(int_fast64_t j = 1; j <= y_size_; j++) {
+            top[j] = open_ + j * extend_;
+            gaps[j] = affine_minus_infinity<P>();
+         }
+      }
+
+      void operator()(const I_type &x, P column, const P *top, P *bottom, P *gaps, uint8_t *move_row = nullptr,
+         uint8_t *extend_row = nullptr)
+      {
+         bottom[0] = column;
+         gaps[0] = column;
+         P e = affine_minus_infinity<P>();
+         auto y_cur = y_begin_;
+         for(int_fast64_t j = 1; j <= y_size_; j++, y_cur++) {
+            P f_extend = gaps[j] + extend_, f_open = top[j] + open_ + extend_;
+            P e_extend = e + extend_, e_open = bottom[j-1] + open_ + extend_;
+            P f = std::max(f_extend, f_open);
+            e = std::max(e_extend, e_open);
+            P sub = top[j-1] + score_function_(x, *y_cur);
+            nw_move move;
+            if(sub >= f && sub >= e) {
+               bottom[j] = sub;
+               move = NW_DIAG;
+            } else if(f >= e) {
+               bottom[j] = f;
+               move = NW_UP;
+            } else {
+               bottom[j] = e;
+               move = NW_LEFT;
+            }
+            gaps[j] = f;
+            if(move_row) {
+               traceback_plane::set(move_row, j, move);
+               traceback_plane::set(extend_row, j, static_cast<nw_move>((e_extend > e_open ? AFFINE_E_EXTENDS : 0)
+                  | (f_extend > f_open ? AFFINE_F_EXTENDS : 0)));
+            }
+         }
+      }
+
+   private:
+      I              y_begin_, y_end_;
+      int_fast64_t   y_size_;
+      F_type         &score_function_;
+      P              open_, extend_;
+   };
+
+#if STRINGALGORITHMS_SIMD
+
+   template<typename I, typename F>
+   class gotoh_row_sweep<I, F, true> {
+   public:
+      typedef int16_t                                       P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+      typedef typename std::remove_reference<F>::type       F_type;
+      typedef simd::i16                                     V;
+
+      gotoh_row_sweep(I y_begin, I y_end, F_type &score_function, P open, P extend, std::vector<P> *profile = nullptr) :
+         y_begin_(y_begin), y_end_(y_end), y_size_(std::distance(y_begin, y_end)), score_function_(score_function), open_(open),
+         extend_(extend), profile_(profile ? *profile : own_profile_), e_(y_size_ + 1)
+      {
+         profile_.clear();
+         std::fill(std::begin(index_), std::end(index_), -1);
+         for(int s = 0; s < V::gap_steps; s++) gap_[s] = V::set1(simd::saturate16(extend * (int_fast64_t(1) << s)));
+         P ramp[V::lanes];
+         for(int l = 0; l < V::lanes; l++) ramp[l] = simd::saturate16((l + 1) * int_fast64_t(extend));
+         ramp_ = V::load(ramp);
+         extend_v_ = V::set1(extend);
+         open_v_ = V::set1(open);
+         open_extend_v_ = V::set1(simd::saturate16(int_fast64_t(open) + extend));
+      }
+
+      void first_row(P *top, P *gaps) const {
+         top[0] = 0;
+         gaps[0] = INT16_MIN;
+         for(int_fast64_t j = 1; j <= y_size_; j++) {
+            top[j] = simd::saturate16(open_ + j * int_fast64_t(extend_));
+            gaps[j] = INT16_MIN;
+         }
+      }
+
+      // the scalar cells use the same saturating arithmetic as the lanes so the moves can be found by comparison
+      static P adds(int_fast64_t a, int_fast64_t b) { return simd::saturate16(a + b); }
+
+      void operator()(const I_type &x, P column, const P *top, P *bottom, P *gaps, uint8_t *move_row = nullptr,
+         uint8_t *extend_row = nullptr)
+      {
+         const P *prof = profile(x);
+         P *e_row = e_.data();
+         P open_extend = adds(open_, extend_);
+
+         bottom[0] = column;
+         gaps[0] = column;
+
+         // carry is the best H'[k] + open + (j - 1 - k) * extend for k < j, E[j] is carry + extend
+         P carry = adds(column, open_);
+
+         int_fast64_t j = 1;
+         alignas(32) P last[V::lanes];
+         for(; j + V::lanes - 1 <= y_size_; j += V::lanes) {
+            auto f = V::max(V::adds(V::load(gaps + j), extend_v_), V::adds(V::load(top + j), open_extend_v_));
+            V::store(gaps + j, f);
+            auto h = V::max(V::adds(V::load(top + j - 1), V::load(prof + j)), f);
+            auto t = V::prefix_max(V::adds(h, open_v_), gap_);
+            auto carried = V::adds(V::set1(carry), ramp_);
+            auto e = V::max(V::adds(V::shift_up<1>(t), extend_v_), carried);
+            V::store(e_row + j, e);
+            V::store(bottom + j, V::max(h, e));
+            V::store(last, V::max(t, carried));
+            carry = last[V::lanes - 1];
+         }
+         for(; j <= y_size_; j++) {
+            P f = std::max(adds(gaps[j], extend_), adds(top[j], open_extend));
+            gaps[j] = f;
+            P h = std::max(adds(top[j-1], prof[j]), f);
+            P e = adds(carry, extend_);
+            e_row[j] = e;
+            bottom[j] = std::max(h, e);
+            carry = std::max(adds(carry, extend_), adds(h, open_));
+         }
+
+         if(move_row) moves(prof, top, bottom, gaps, move_row, extend_row);
+      }
+
+      // the row of score(x, y[j-1]) for j in 1..y_size, built the first time x is seen
+      const P *profile(const I_type &x) {
+         auto c = static_cast<unsigned char>(x);
+         if(index_[c] < 0) {
+            index_[c] = profile_.size();
+            profile_.resize(profile_.size() + y_size_ + 1);
+            nw_profile_row(x, y_begin_, y_end_, score_function_, profile_.data() + index_[c],
+               std::integral_constant<bool, nw_profile_eligible<I, F>::value>());
+         }
+         return profile_.data() + index_[c];
+      }
+
+   private:
+      // H is whichever of its three scores it equals, first the diagonal then up, and E and F extend when opening
+      // wouldn't have given the same score
+      void move(const P *prof, const P *top, const P *bottom, const P *gaps, uint8_t *move_row, uint8_t *extend_row, int_fast64_t j) {
+         P open_extend = adds(open_, extend_);
+         P h = bottom[j];
+         traceback_plane::set(move_row, j, h == adds(top[j-1], prof[j]) ? NW_DIAG : (h == gaps[j] ? NW_UP : NW_LEFT));
+         traceback_plane::set(extend_row, j, static_cast<nw_move>((e_[j] != adds(bottom[j-1], open_extend) ? AFFINE_E_EXTENDS : 0)
+            | (gaps[j] != adds(top[j], open_extend) ? AFFINE_F_EXTENDS : 0)));
+      }
+
+      void moves(const P *prof, const P *top, const P *bottom, const P *gaps, uint8_t *move_row, uint8_t *extend_row) {
+         auto up_code = V::set1(NW_UP);
+         auto left_code = V::set1(NW_LEFT);
+         auto e_code = V::set1(AFFINE_E_EXTENDS);
+         auto f_code = V::set1(AFFINE_F_EXTENDS);
+
+         // cells 1..3 share a byte with cell 0, after that whole vectors of moves start on a byte
+         int_fast64_t j = 1;
+         for(; j <= y_size_ && j < 4; j++) move(prof, top, bottom, gaps, move_row, extend_row, j);
+         for(; j + V::lanes - 1 <= y_size_; j += V::lanes) {
+            auto h = V::load(bottom + j);
+            auto f = V::load(gaps + j);
+            auto diag = V::cmpeq(h, V::adds(V::load(top + j - 1), V::load(prof + j)));
+            auto up = V::cmpeq(h, f);
+            V::pack_2bit(V::bit_andnot(diag, V::bit_or(V::bit_and(up, up_code), V::bit_andnot(up, left_code))), move_row + (j >> 2));
+            auto e_open = V::cmpeq(V::load(e_.data() + j), V::adds(V::load(bottom + j - 1), open_extend_v_));
+            auto f_open = V::cmpeq(f, V::adds(V::load(top + j), open_extend_v_));
+            V::pack_2bit(V::bit_or(V::bit_andnot(e_open, e_code), V::bit_andnot(f_open, f_code)), extend_row + (j >> 2));
+         }
+         for(; j <= y_size_; j++) move(prof, top, bottom, gaps, move_row, extend_row, j);
+      }
+
+      I                 y_begin_, y_end_;
+      int_fast64_t      y_size_;
+      F_type            &score_function_;
+      P                 open_, extend_;
+      int_fast64_t      index_[256];
+      std::vector<P>    own_profile_;
+      std::vector<P>    &profile_;
+      std::vector<P>    e_;
+      V::type           gap_[V::gap_steps], ramp_, extend_v_, open_v_, open_extend_v_;
+   };
+
+#endif // STRINGALGORITHMS_SIMD
+
+   // The last rows of H and F for x against y, H is left in whichever of top and bottom is returned and F in gaps
+
+   template<typename I, typename F>
+   typename PP<F, I>::type *
+   gotoh_score_row(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type open,
+      typename PP<F, I>::type extend, typename PP<F, I>::type tb, typename PP<F, I>::type *top, typename PP<F, I>::type *bottom,
+      typename PP<F, I>::type *gaps, std::vector<typename PP<F, I>::type> *profile = nullptr)
+   {
+      typedef typename PP<F, I>::type P;
+
+      gotoh_row_sweep<I, F> sweep(y_begin, y_end, score_function, open, extend, profile);
+
+      sweep.first_row(top, gaps);
+      P column = tb;
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++) {
+         column += extend;
+         sweep(*x_cur, column, top, bottom, gaps);
+         std::swap(top, bottom);
+      }
+      return top;
+   }
+
+   // Fill the moves and extend planes for x and y, returns H[x_size][y_size] and sets gap to F[x_size][y_size]
+
+   template<typename I, typename F>
+   typename PP<F, I>::type
+   gotoh_traceback_matrix(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, traceback_plane &moves, traceback_plane &extends,
+      typename PP<F, I>::type open, typename PP<F, I>::type extend, typename PP<F, I>::type tb, typename PP<F, I>::type *top,
+      typename PP<F, I>::type *bottom, typename PP<F, I>::type *gaps, typename PP<F, I>::type &gap,
+      std::vector<typename PP<F, I>::type> *profile = nullptr)
+   {
+      typedef typename PP<F, I>::type P;
+
+      auto x_size = std::distance(x_begin, x_end);
+      auto y_size = std::distance(y_begin, y_end);
+
+      moves.resize(x_size + 1, y_size + 1);
+      extends.resize(x_size + 1, y_size + 1);
+
+      gotoh_row_sweep<I, F> sweep(y_begin, y_end, score_function, open, extend, profile);
+
+      sweep.first_row(top, gaps);
+      P column = tb;
+      int_fast64_t i = 1;
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++, i++) {
+         column += extend;
+         sweep(*x_cur, column, top, bottom, gaps, moves.row(i), extends.row(i));
+         std::swap(top, bottom);
+      }
+      gap = gaps[y_size];
+      return top[y_size];
+   }
+
+   // Walk the planes back from the last cell appending the alignment to w and z in reverse order, starting in F
+   // when the alignment ends in a deletion. Row 0 and column 0 are all gaps so they aren't read from the planes.
+
+   template<typename I, typename T>
+   void gotoh_traceback_reversed(const traceback_plane &moves, const traceback_plane &extends, I x_begin, I x_end, I y_begin, I y_end,
+      std::vector<T> &w, std::vector<T> &z, const T deleted_value, bool end_in_deletion = false)
+   {
+      int_fast64_t   i = std::distance(x_begin, x_end);
+      int_fast64_t   j = std::distance(y_begin, y_end);
+
+      auto x_cur = x_end;
+      auto y_cur = y_end;
+
+      nw_move state = end_in_deletion ? NW_UP : NW_DIAG;
+
+      while(i != 0 && j != 0) {
+         if(state == NW_DIAG) {
+            state = moves(i, j);
+            if(state != NW_DIAG) continue;
+            --x_cur; --y_cur;
+            w.push_back(*x_cur);
+            z.push_back(*y_cur);
+            i--; j--;
+         } else if(state == NW_UP) {
+            --x_cur;
+            w.push_back(*x_cur);
+            z.push_back(deleted_value);
+            if(!(extends(i, j) & AFFINE_F_EXTENDS)) state = NW_DIAG;
+            i--;
+         } else {
+            --y_cur;
+            w.push_back(deleted_value);
+            z.push_back(*y_cur);
+            if(!(extends(i, j) & AFFINE_E_EXTENDS)) state = NW_DIAG;
+            j--;
+         }
+      }
+      for(; i != 0; i--) {
+         w.push_back(*--x_cur);
+         z.push_back(deleted_value);
+      }
+      for(; j != 0; j--) {
+         w.push_back(deleted_value);
+         z.push_back(*--y_cur);
+      }
+   }
+
+   // Needleman-Wunsch with affine gaps in a full traceback plane (two, 4 bits per cell)
+
+   template<typename I, typename BI, typename F>
+   void Gotoh(I x_begin, I x_end, I y_begin, I y_end, BI w_back, BI z_back, F &&score_function, typename PP<F, I>::type open,
+      typename PP<F, I>::type extend, const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      typedef typename PP<F, I>::type                       P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+
+      auto y_size = std::distance(y_begin, y_end);
+
+      std::vector<P>    top(y_size + 1), bottom(y_size + 1), gaps(y_size + 1);
+      traceback_plane   moves, extends;
+      P                 gap;
+
+      gotoh_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, moves, extends, open, extend, open, top.data(), bottom.data(),
+         gaps.data(), gap);
+
+      std::vector<I_type> w, z;
+      gotoh_traceback_reversed(moves, extends, x_begin, x_end, y_begin, y_end, w, z, deleted_value);
+      std::copy(w.rbegin(), w.rend(), w_back);
+      std::copy(z.rbegin(), z.rend(), z_back);
+   }
+
+   // Scratch space for MyersMiller, like hirschberg_workspace with the F rows and the second plane
+
+   template<typename P, typename T>
+   class affine_workspace {
+   public:
+      explicit affine_workspace(int_fast64_t cutoff = hirschberg_default_cutoff()) : cutoff(cutoff) {}
+
+      void reserve(int_fast64_t y_size) {
+         if((int_fast64_t)rows_[0].size() < y_size + 1) {
+            for(auto &r : rows_) r.resize(y_size + 1);
+         }
+      }
+
+      P *row(int k) { return rows_[k].data(); }
+
+      int_fast64_t      cutoff;
+      std::vector<P>    profile;
+      traceback_plane   moves, extends;
+      std::vector<T>    w, z;
+
+   private:
+      std::vector<P>    rows_[6];
+   };
+
+   // One Myers-Miller sub-problem, tb and te are the open scores of a deletion at its start and end
+   // x is split in the middle and y where the forward and reverse halves join best, either with both halves meeting
+   // in H or with a deletion running across the split whose open score was counted by both halves. In that case
+   // x[mid - 1] and x[mid] are deleted here and the halves either side are solved with a free open next to them.
+
+   template<typename I, typename BI, typename F, typename P, typename T>
+   void myers_miller_step(I x_begin, I x_end, I y_begin, I y_end, BI &w_back, BI &z_back, F &score_function, P open, P extend, P tb, P te,
+      const T deleted_value, affine_workspace<P, T> &workspace)
+   {
+      typedef typename std::common_type<P, int_fast64_t>::type W;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      if(x_size == 0) {
+         w_back = std::fill_n(w_back, y_size, deleted_value);
+         z_back = std::copy(y_begin, y_end, z_back);
+      } else if(y_size == 0) {
+         w_back = std::copy(x_begin, x_end, w_back);
+         z_back = std::fill_n(z_back, x_size, deleted_value);
+      } else if(x_size == 1 || y_size == 1 || x_size * y_size <= workspace.cutoff) {
+         P gap;
+         P score = gotoh_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, workspace.moves, workspace.extends, open, extend,
+            tb, workspace.row(0), workspace.row(1), workspace.row(4), gap, &workspace.profile);
+         workspace.w.clear();
+         workspace.z.clear();
+         gotoh_traceback_reversed(workspace.moves, workspace.extends, x_begin, x_end, y_begin, y_end, workspace.w, workspace.z,
+            deleted_value, W(gap) - open + te > W(score));
+         w_back = std::copy(workspace.w.rbegin(), workspace.w.rend(), w_back);
+         z_back = std::copy(workspace.z.rbegin(), workspace.z.rend(), z_back);
+      } else {
+         auto x_mid = x_size / 2;
+
+         P *left = gotoh_score_row(x_begin, x_begin + x_mid, y_begin, y_end, score_function, open, extend, tb,
+            workspace.row(0), workspace.row(1), workspace.row(4), &workspace.profile);
+         P *right = gotoh_score_row(std::reverse_iterator<I>(x_end), std::reverse_iterator<I>(x_begin + x_mid),
+            std::reverse_iterator<I>(y_end), std::reverse_iterator<I>(y_begin), score_function, open, extend, te,
+            workspace.row(2), workspace.row(3), workspace.row(5), &workspace.profile);
+         const P *left_gaps = workspace.row(4), *right_gaps = workspace.row(5);
+
+         // the first best join, meeting in H before a deletion across the split at the same column
+         int_fast64_t   y_mid = 0;
+         bool           across = false;
+         W              best = W(left[0]) + right[y_size];
+         for(int_fast64_t j = 0; j <= y_size; j++) {
+            W meet = W(left[j]) + right[y_size - j];
+            W deletion = W(left_gaps[j]) + right_gaps[y_size - j] - open;
+            if(meet > best) best = meet, y_mid = j, across = false;
+            if(deletion > best) best = deletion, y_mid = j, across = true;
+         }
+
+         if(!across) {
+            myers_miller_step(x_begin, x_begin + x_mid, y_begin, y_begin + y_mid, w_back, z_back, score_function, open, extend, tb, open,
+               deleted_value, workspace);
+            myers_miller_step(x_begin + x_mid, x_end, y_begin + y_mid, y_end, w_back, z_back, score_function, open, extend, open, te,
+               deleted_value, workspace);
+         } else {
+            myers_miller_step(x_begin, x_begin + x_mid - 1, y_begin, y_begin + y_mid, w_back, z_back, score_function, open, extend, tb, P(0),
+               deleted_value, workspace);
+            w_back = std::copy(x_begin + x_mid - 1, x_begin + x_mid + 1, w_back);
+            z_back = std::fill_n(z_back, 2, deleted_value);
+            myers_miller_step(x_begin + x_mid + 1, x_end, y_begin + y_mid, y_end, w_back, z_back, score_function, open, extend, P(0), te,
+               deleted_value, workspace);
+         }
+      }
+   }
+
+   // Affine gap alignment in linear space (Myers-Miller), the affine version of Hirschberg
+   // sub-problems of cutoff cells or fewer are solved with the full Gotoh matrix
+
+   template<typename I, typename BI, typename F>
+   void MyersMiller(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function,
+      affine_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> &workspace, typename PP<F, I>::type open,
+      typename PP<F, I>::type extend, const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      workspace.reserve(std::distance(y_begin, y_end));
+      myers_miller_step(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, open, extend, open, open, deleted_value, workspace);
+   }
+
+   template<typename I, typename BI, typename F>
+   void MyersMiller(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, typename PP<F, I>::type open,
+      typename PP<F, I>::type extend, const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      affine_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> workspace;
+      MyersMiller(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, workspace, open, extend, deleted_value);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_affine_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_affine_suite(void)
+   {
+      return 0;
+   }
+
+   void affine_test(void)
+   {
+      // the score of an alignment with affine gaps
+      auto affine_score = [](const std::string &w, const std::string &z, int open, int extend) {
+         int s = 0;
+         bool in_w = false, in_z = false;
+         for(size_t i = 0; i < w.size(); i++) {
+            if(w[i] == '-') {
+               s += (in_w ? 0 : open) + extend;
+            } else if(z[i] == '-') {
+               s += (in_z ? 0 : open) + extend;
+            } else {
+               s += w[i] == z[i] ? 1 : -1;
+            }
+            in_w = w[i] == '-';
+            in_z = z[i] == '-';
+         }
+         return s;
+      };
+
+      std::vector<std::string> result(2), expected = { "AAACCCGGG", "AAA---GGG" };
+      std::string x = "AAACCCGGG", y = "AAAGGG";
+      Gotoh(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]), scoring::plus_minus_one, -5, -1);
+      CU_ASSERT(result == expected);
+
+      // no open score is the linear gap
+      x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+      result.assign(2, std::string());
+      expected.assign(2, std::string());
+      Gotoh(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]), scoring::plus_minus_one, 0, -1);
+      NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected[0]), std::back_inserter(expected[1]),
+         scoring::plus_minus_one);
+      CU_ASSERT(result == expected);
+
+      // Myers-Miller scores the same as Gotoh at any cutoff and is Gotoh when the cutoff covers the whole problem
+      auto wide = [](const char &a, const char &b) -> int32_t { return a == b ? 1 : -1; };
+      std::string w, z;
+      Gotoh(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z), wide, -4, -1);
+      int optimal = affine_score(w, z, -4, -1);
+
+      for(int_fast64_t cutoff : { 0, 64, 1 << 20 }) {
+         std::string s, t;
+         affine_workspace<int16_t, char> workspace(cutoff);
+         MyersMiller(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(s), std::back_inserter(t), scoring::plus_minus_one, workspace,
+            -4, -1);
+         CU_ASSERT(affine_score(s, t, -4, -1) == optimal);
+         if(cutoff == 1 << 20) CU_ASSERT(s == w && t == z);
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // AFFINE_HPP
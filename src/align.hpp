@@ -0,0 +1,209 @@
+#ifndef ALIGN_HPP
+#define ALIGN_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+#include "parallelhirschberg.hpp"
+#include "banded.hpp"
+#include "checkpoint.hpp"
+
+namespace stringAlgorithms {
+
+   // Choosing an alignment engine
+   //
+   // Every engine here gives a best global alignment, they differ in the memory they need and how fast they fill cells.
+   // NeedlemanWunsch is the fastest but keeps 2 bits for every cell, CheckpointNeedlemanWunsch does about half the
+   // cells again in whatever memory it is given, Hirschberg does them all again in linear space and BandedHirschberg
+   // only computes the cells near the diagonal, which is a win when the inputs are known to be alike. align() estimates
+   // the time of each engine that fits in the budget from its measured cells per second and runs the quickest. The
+   // rates are machine dependent, align_calibrate measures them and prints an align_calibration to use instead of the
+   // defaults.
+
+   enum align_engine { ALIGN_NEEDLEMAN_WUNSCH, ALIGN_BANDED, ALIGN_CHECKPOINT, ALIGN_HIRSCHBERG, ALIGN_PARALLEL_HIRSCHBERG };
+
+   // Cells per second of each engine on a plus_minus_one byte alignment, and how well ParallelHirschberg scales
+
+   struct align_calibration {
+      double         full_rate;              // NeedlemanWunsch
+      double         checkpoint_rate;        // CheckpointNeedlemanWunsch with blocks of about sqrt(x_size) rows
+      double         hirschberg_rate;        // Hirschberg
+      double         banded_rate;            // BandedHirschberg, counting the x_size * (2k + 1) cells of its final band
+      double         parallel_efficiency;    // the speedup of each ParallelHirschberg thread after the first
+      int_fast64_t   parallel_cells;         // fewer cells than this aren't worth starting threads for
+   };
+
+   // measured by align_calibrate on an x86-64 core with -O2, the two thread figures are typical of ParallelHirschberg
+   // on a few cores rather than measured
+
+   inline const align_calibration &default_align_calibration() {
+      static const align_calibration calibration = { 1.1e9, 9.8e8, 8.7e8, 6.3e7, 0.75, int_fast64_t(1) << 22 };
+      return calibration;
+   }
+
+   // The k BandedHirschberg is expected to end with for inputs whose elements are similarity (0 to 1) alike
+
+   inline int_fast64_t align_expected_band(int_fast64_t x_size, int_fast64_t y_size, double similarity) {
+      double differences = (1 - std::min(1.0, std::max(0.0, similarity))) * std::max(x_size, y_size);
+      return std::max<int_fast64_t>(32, std::llround(differences) + std::abs(x_size - y_size));
+   }
+
+   // The engine expected to be quickest for inputs of x_size and y_size within budget bytes of scores and moves.
+   // similarity is the expected fraction of matching elements, below 0 if it isn't known, threads = 0 is every core.
+
+   template<typename P>
+   align_engine choose_align_engine(int_fast64_t x_size, int_fast64_t y_size, int_fast64_t budget, double similarity = -1,
+      unsigned threads = 1, const align_calibration &calibration = default_align_calibration())
+   {
+      if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+      double cells = double(x_size) * double(y_size);
+      align_engine best = ALIGN_HIRSCHBERG;
+      double best_time = cells / calibration.hirschberg_rate;
+
+      auto consider = [&](align_engine engine, double time) {
+         if(time < best_time) best = engine, best_time = time;
+      };
+
+      // the whole plane of moves and two rows of scores
+      int_fast64_t full_bytes = (x_size + 1) * ((y_size + 4) / 4) + 2 * (y_size + 1) * int_fast64_t(sizeof(P));
+      if(full_bytes <= budget) consider(ALIGN_NEEDLEMAN_WUNSCH, cells / calibration.full_rate);
+
+      if(checkpoint_rows<P>(x_size, y_size, budget) > 0) consider(ALIGN_CHECKPOINT, cells / calibration.checkpoint_rate);
+
+      if(similarity >= 0) {
+         int_fast64_t k = align_expected_band(x_size, y_size, similarity);
+         if(2 * (k + 1) <= x_size + y_size - std::abs(y_size - x_size)) {
+            consider(ALIGN_BANDED, double(x_size) * double(2 * k + 1) / calibration.banded_rate);
+         }
+      }
+
+      if(threads > 1 && cells >= calibration.parallel_cells) {
+         double speedup = 1 + (threads - 1) * calibration.parallel_efficiency;
+         consider(ALIGN_PARALLEL_HIRSCHBERG, cells / (calibration.hirschberg_rate * speedup));
+      }
+      return best;
+   }
+
+   // A best global alignment of x and y written to w_back and z_back by whichever engine choose_align_engine() picks
+   // for the budget, similarity hint and threads, returns the engine used. The iterators must be random access. Which
+   // of several equally good alignments is written depends on the engine.
+
+   template<typename I, typename BI, typename F>
+   align_engine align(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, int_fast64_t budget,
+      typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-', double similarity = -1,
+      unsigned threads = 1, const align_calibration &calibration = default_align_calibration())
+   {
+      typedef typename PP<F, I>::type P;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      align_engine engine = choose_align_engine<P>(x_size, y_size, budget, similarity, threads, calibration);
+      switch(engine) {
+         case ALIGN_NEEDLEMAN_WUNSCH:
+            NeedlemanWunsch(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value);
+            break;
+         case ALIGN_BANDED:
+            BandedHirschberg(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value);
+            break;
+         case ALIGN_CHECKPOINT:
+            CheckpointNeedlemanWunsch(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, budget, ID, deleted_value);
+            break;
+         case ALIGN_HIRSCHBERG:
+            Hirschberg(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value);
+            break;
+         case ALIGN_PARALLEL_HIRSCHBERG:
+            ParallelHirschberg(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value, threads);
+            break;
+      }
+      return engine;
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_align_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_align_suite(void)
+   {
+      return 0;
+   }
+
+   void align_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAAATTCACATCTTTACAG";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAATTCACATCTTACAGAACTTTAGC";
+
+      const align_calibration &c = default_align_calibration();
+      int_fast64_t big = int_fast64_t(1) << 40;
+
+      // plenty of memory is the full matrix, a little is checkpointed and none is Hirschberg
+      CU_ASSERT(choose_align_engine<int16_t>(1000, 1000, big) == ALIGN_NEEDLEMAN_WUNSCH);
+      CU_ASSERT(choose_align_engine<int16_t>(1000000, 1000000, int_fast64_t(1) << 31) == ALIGN_CHECKPOINT);
+      CU_ASSERT(choose_align_engine<int16_t>(1000000, 1000000, 0) == ALIGN_HIRSCHBERG);
+
+      // alike inputs go to the band, more threads to ParallelHirschberg once there are enough cells
+      CU_ASSERT(choose_align_engine<int16_t>(1000000, 1000000, 0, 0.99) == ALIGN_BANDED);
+      CU_ASSERT(choose_align_engine<int16_t>(1000000, 1000000, 0, 0.2) == ALIGN_HIRSCHBERG);
+      CU_ASSERT(choose_align_engine<int16_t>(1000000, 1000000, 0, -1, 8) == ALIGN_PARALLEL_HIRSCHBERG);
+      CU_ASSERT(choose_align_engine<int16_t>(100, 100, 0, -1, 8) == ALIGN_HIRSCHBERG);
+
+      // a calibration where the band is slow never picks it
+      align_calibration slow_band = c;
+      slow_band.banded_rate = 1;
+      CU_ASSERT(choose_align_engine<int16_t>(1000000, 1000000, 0, 0.99, 1, slow_band) == ALIGN_HIRSCHBERG);
+
+      // every engine gives an alignment with the best score
+      int16_t best = nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one).back();
+      // calibrations which favour the band and the threads so those engines run on an input this small
+      align_calibration fast_band = c, eager_parallel = c;
+      fast_band.banded_rate = 1e30;
+      eager_parallel.parallel_cells = 0;
+      std::vector<int_fast64_t> budgets = { big, checkpoint_bytes<int16_t>(x.size(), y.size(), 20), 0 };
+      std::vector<const align_calibration *> calibrations = { &c, &fast_band, &eager_parallel };
+      std::vector<align_engine> engines;
+      for(int_fast64_t budget : budgets) {
+         for(const align_calibration *calibration : calibrations) {
+            std::vector<std::string> result(2, std::string());
+            engines.push_back(align(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+               scoring::plus_minus_one, budget, int16_t(-1), '-', 0.9, 2, *calibration));
+            int16_t score = 0;
+            std::string w, z;
+            for(size_t i = 0; i < result[0].size(); i++) {
+               score += result[0][i] == '-' || result[1][i] == '-' ? -1 : scoring::plus_minus_one(result[0][i], result[1][i]);
+               if(result[0][i] != '-') w.push_back(result[0][i]);
+               if(result[1][i] != '-') z.push_back(result[1][i]);
+            }
+            CU_ASSERT(score == best && w == x && z == y);
+            if(score != best) {
+               std::cout << std::endl;
+               std::cout << "result[0] = " << result[0] << std::endl;
+               std::cout << "result[1] = " << result[1] << std::endl;
+            }
+         }
+      }
+      for(align_engine engine : { ALIGN_NEEDLEMAN_WUNSCH, ALIGN_BANDED, ALIGN_CHECKPOINT, ALIGN_HIRSCHBERG, ALIGN_PARALLEL_HIRSCHBERG }) {
+         CU_ASSERT(std::find(engines.begin(), engines.end(), engine) != engines.end());
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // ALIGN_HPP
@@ -0,0 +1,143 @@
+#include <config.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "align.hpp"
+
+using stringAlgorithms::align_calibration;
+using stringAlgorithms::BandedHirschberg;
+using stringAlgorithms::CheckpointNeedlemanWunsch;
+using stringAlgorithms::Hirschberg;
+using stringAlgorithms::NeedlemanWunsch;
+using stringAlgorithms::ParallelHirschberg;
+using stringAlgorithms::checkpoint_bytes;
+using stringAlgorithms::nw_band_search;
+using stringAlgorithms::scoring::plus_minus_one;
+
+// measures the cells per second of each engine align() chooses from and prints an align_calibration for this machine
+
+std::string random_dna(std::mt19937 &random, int size)
+{
+   std::string s(size, 'A');
+   for(auto &c : s) c = "ACGT"[random() % 4];
+   return s;
+}
+
+// s with about one element in rate substituted, inserted or deleted
+
+std::string mutate(std::mt19937 &random, const std::string &s, double rate)
+{
+   std::string t;
+   std::uniform_real_distribution<double> chance(0, 1);
+   for(char c : s) {
+      double r = chance(random);
+      if(r < rate / 3) continue;
+      else if(r < 2 * rate / 3) t.push_back("ACGT"[random() % 4]);
+      else if(r < rate) t.push_back(c), t.push_back("ACGT"[random() % 4]);
+      else t.push_back(c);
+   }
+   return t;
+}
+
+// the seconds per call of f, repeated until at least a quarter of a second has gone
+
+template<typename F>
+double seconds(F &&f)
+{
+   auto start = std::chrono::steady_clock::now();
+   int calls = 0;
+   double elapsed;
+   do {
+      f();
+      calls++;
+      elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   } while(elapsed < 0.25);
+   return elapsed / calls;
+}
+
+int main(int argc, char *argv[])
+{
+   int         size = 4000;
+   unsigned    threads = std::max(1u, std::thread::hardware_concurrency());
+   int         c;
+
+   while((c = getopt(argc, argv, "n:t:")) != -1) {
+      switch(c) {
+         case 'n':
+            size = atoi(optarg);
+            break;
+         case 't':
+            threads = atoi(optarg);
+            break;
+      }
+   }
+
+   std::mt19937 random(1);
+   std::string x = random_dna(random, size);
+   std::string y = mutate(random, x, 0.3);
+   std::string z = mutate(random, x, 0.02);
+   double cells = double(x.size()) * double(y.size());
+
+   auto run = [&](const std::string &a, const std::string &b, int engine) {
+      return seconds([&] {
+         std::string w, v;
+         switch(engine) {
+            case 0:
+               NeedlemanWunsch(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(w), std::back_inserter(v), plus_minus_one);
+               break;
+            case 1:
+               CheckpointNeedlemanWunsch(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(w), std::back_inserter(v), plus_minus_one,
+                  checkpoint_bytes<int16_t>(a.size(), b.size(), std::max(1, int(std::sqrt(double(a.size()))))));
+               break;
+            case 2:
+               Hirschberg(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(w), std::back_inserter(v), plus_minus_one);
+               break;
+            case 3:
+               BandedHirschberg(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(w), std::back_inserter(v), plus_minus_one);
+               break;
+            default:
+               ParallelHirschberg(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(w), std::back_inserter(v), plus_minus_one,
+                  int16_t(-1), '-', threads);
+               break;
+         }
+      });
+   };
+
+   align_calibration calibration;
+   double hirschberg_seconds = run(x, y, 2);
+   calibration.full_rate = cells / run(x, y, 0);
+   calibration.checkpoint_rate = cells / run(x, y, 1);
+   calibration.hirschberg_rate = cells / hirschberg_seconds;
+
+   // the band is counted the way align() estimates it, from the k the search ends with
+   std::vector<int16_t> top(z.size() + 1), bottom(z.size() + 1);
+   int_fast64_t k = nw_band_search(x.begin(), x.end(), z.begin(), z.end(), plus_minus_one, int16_t(-1), 32, top.data(), bottom.data());
+   calibration.banded_rate = double(x.size()) * double(2 * k + 1) / run(x, z, 3);
+
+   // the speedup at this size, then the smallest power of 2 size at which the threads are quicker than one
+   calibration.parallel_efficiency = 0;
+   calibration.parallel_cells = int_fast64_t(1) << 62;
+   if(threads > 1) {
+      calibration.parallel_efficiency = std::max(0.0, (hirschberg_seconds / run(x, y, 4) - 1) / (threads - 1));
+      for(int n = 256; n <= size; n *= 2) {
+         std::string a = x.substr(0, n), b = y.substr(0, n);
+         if(run(a, b, 4) < run(a, b, 2)) {
+            calibration.parallel_cells = int_fast64_t(n) * n;
+            break;
+         }
+      }
+   }
+
+   printf("// %d x %d elements, %u threads\n", int(x.size()), int(y.size()), threads);
+   printf("stringAlgorithms::align_calibration calibration = { %.3g, %.3g, %.3g, %.3g, %.3g, %lld };\n", calibration.full_rate,
+      calibration.checkpoint_rate, calibration.hirschberg_rate, calibration.banded_rate, calibration.parallel_efficiency,
+      (long long)calibration.parallel_cells);
+
+   return 0;
+}
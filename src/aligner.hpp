@@ -0,0 +1,168 @@
+#ifndef ALIGNER_HPP
+#define ALIGNER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+
+namespace stringAlgorithms {
+
+   // Needleman-Wunsch for many calls
+   //
+   // NeedlemanWunsch allocates its traceback plane, two rows of scores, the lookup table and the two reversed result
+   // vectors on every call, and for small inputs that costs more than the cells. An Aligner keeps all of them between
+   // calls and only grows them when an input is longer than any before. The traceback is walked once to count the
+   // columns and again to write each one where it belongs, so nothing is reversed or copied afterwards. The alignment
+   // is the same one NeedlemanWunsch gives. P is the score type of the score function and T the element type.
+
+   template<typename P, typename T = char>
+   class Aligner {
+   public:
+      // align x and y into the aligner's own buffers, w() and z() hold the columns until the next call
+      // returns the number of columns
+      template<typename I, typename F>
+      int_fast64_t align(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, P ID = -1, const T deleted_value = '-') {
+         int_fast64_t size = std::distance(x_begin, x_end) + std::distance(y_begin, y_end);
+         if((int_fast64_t)w_.size() < size) w_.resize(size), z_.resize(size);
+         return align_into(x_begin, x_end, y_begin, y_end, w_.data(), z_.data(), score_function, ID, deleted_value);
+      }
+
+      // align x and y writing the columns to w_out and z_out, random access iterators with room for x_size + y_size
+      // elements, returns the number of columns
+      template<typename I, typename O, typename F>
+      int_fast64_t align_into(I x_begin, I x_end, I y_begin, I y_end, O w_out, O z_out, F &&score_function, P ID = -1,
+         const T deleted_value = '-')
+      {
+         static_assert(std::is_same<typename PP<F, I>::type, P>::value, "the score function must return the Aligner's score type");
+
+         int_fast64_t x_size = std::distance(x_begin, x_end);
+         int_fast64_t y_size = std::distance(y_begin, y_end);
+
+         if((int_fast64_t)top_.size() < y_size + 1) top_.resize(y_size + 1), bottom_.resize(y_size + 1);
+         score_ = nw_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, moves_, ID, top_.data(), bottom_.data(), &profile_);
+
+         // the number of columns first so the second walk can write each one in place
+         int_fast64_t columns = 0;
+         for(int_fast64_t i = x_size, j = y_size; i != 0 || j != 0; columns++) {
+            switch(moves_(i, j)) {
+               case NW_DIAG: i--; j--; break;
+               case NW_UP: i--; break;
+               default: j--; break;
+            }
+         }
+
+         int_fast64_t k = columns;
+         for(int_fast64_t i = x_size, j = y_size; i != 0 || j != 0; ) {
+            k--;
+            switch(moves_(i, j)) {
+               case NW_DIAG:
+                  w_out[k] = x_begin[--i];
+                  z_out[k] = y_begin[--j];
+                  break;
+               case NW_UP:
+                  w_out[k] = x_begin[--i];
+                  z_out[k] = deleted_value;
+                  break;
+               default:
+                  w_out[k] = deleted_value;
+                  z_out[k] = y_begin[--j];
+                  break;
+            }
+         }
+         columns_ = columns;
+         return columns;
+      }
+
+      const T *w() const { return w_.data(); }
+      const T *z() const { return z_.data(); }
+
+      // the columns and score of the last alignment
+      int_fast64_t columns() const { return columns_; }
+      P score() const { return score_; }
+
+   private:
+      traceback_plane   moves_;
+      std::vector<P>    top_, bottom_, profile_;
+      std::vector<T>    w_, z_;
+      int_fast64_t      columns_ = 0;
+      P                 score_ = 0;
+   };
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_aligner_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_aligner_suite(void)
+   {
+      return 0;
+   }
+
+   void aligner_test(void)
+   {
+      std::vector<std::string> pairs = {
+         "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC",
+         "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA",
+         "CAGACAGCCTGAGACAG", "CACAGACAGCTTGAGAAG",
+         "", "ACGT",
+         "AGT", "",
+         "AAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCCAAGGTTCC",
+         "AGGTTCAAGTTCCAAGGTTCCAAGTTCCAAGGTTCCAGTTCCAAG"
+      };
+
+      // one aligner for inputs growing and shrinking, the same as NeedlemanWunsch every time
+      Aligner<int16_t> aligner;
+      for(size_t k = 0; k < pairs.size(); k += 2) {
+         const std::string &x = pairs[k], &y = pairs[k + 1];
+         std::vector<std::string> expected(2, std::string());
+         NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected[0]), std::back_inserter(expected[1]),
+            scoring::plus_minus_one);
+
+         int_fast64_t columns = aligner.align(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one);
+         std::vector<std::string> result = { std::string(aligner.w(), columns), std::string(aligner.z(), columns) };
+         CU_ASSERT(result == expected && aligner.columns() == columns);
+         CU_ASSERT(aligner.score() == nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one).back());
+         if(result != expected) {
+            std::cout << std::endl;
+            std::cout << "result[0] = " << result[0] << std::endl;
+            std::cout << "result[1] = " << result[1] << std::endl;
+         }
+
+         // into the caller's buffers
+         std::string w(x.size() + y.size(), ' '), z(x.size() + y.size(), ' ');
+         columns = aligner.align_into(x.begin(), x.end(), y.begin(), y.end(), w.begin(), z.begin(), scoring::plus_minus_one);
+         w.resize(columns), z.resize(columns);
+         CU_ASSERT(w == expected[0] && z == expected[1]);
+      }
+
+      // other element types
+      std::vector<int> a = { 1, 2, 3, 4, 5 }, b = { 1, 3, 4, 6, 5 };
+      std::vector<int> s(a.size() + b.size()), t(a.size() + b.size());
+      Aligner<int, int> int_aligner;
+      auto match = [](int p, int q) { return p == q ? 1 : -1; };
+      int_fast64_t columns = int_aligner.align_into(a.begin(), a.end(), b.begin(), b.end(), s.data(), t.data(), match, -1, 0);
+      s.resize(columns), t.resize(columns);
+      std::vector<int> u, v;
+      NeedlemanWunsch(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(u), std::back_inserter(v), match, -1, 0);
+      CU_ASSERT(s == u && t == v);
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // ALIGNER_HPP
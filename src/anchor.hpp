@@ -0,0 +1,358 @@
+#ifndef ANCHOR_HPP
+#define ANCHOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "simd.hpp"
+#include "hirschberg.hpp"
+#include "banded.hpp"
+
+namespace stringAlgorithms {
+
+   // Exact match anchoring before alignment
+   //
+   // Near duplicate inputs spend almost all of their DP on cells where nothing happens. The shared prefix and suffix
+   // are stripped first, compared a vector at a time where the elements are integers in contiguous memory. In what is
+   // left, k-mers which occur exactly once in both x and y are found by hashing, extended to maximal exact matches and
+   // chained into the longest run increasing in both. Only the pieces between these anchors are aligned.
+   //
+   // A matched prefix or suffix is always on an optimal path as long as each element's match scores at least as much
+   // as any substitution of it and at least two gaps (the exchange argument for edit distance), which is what the
+   // banded engines assume too. Anchors in the middle have no such guarantee, so ANCHOR_EXACT scores the pieces and
+   // keeps the anchors only when they add up to the best score of the whole problem, which banded sweeps find cheaply
+   // for near duplicates; ANCHOR_HEURISTIC keeps them without checking.
+
+   enum anchor_mode { ANCHOR_EXACT, ANCHOR_HEURISTIC };
+
+   // x[x, x + length) == y[y, y + length)
+
+   struct nw_anchor {
+      int_fast64_t   x, y, length;
+   };
+
+   // The number of equal elements at the start of x and y
+
+   template<typename I>
+   int_fast64_t common_prefix(I x_begin, I x_end, I y_begin, I y_end, std::false_type)
+   {
+      int_fast64_t length = 0;
+      for(; x_begin != x_end && y_begin != y_end && *x_begin == *y_begin; x_begin++, y_begin++) length++;
+      return length;
+   }
+
+   template<typename I>
+   int_fast64_t common_prefix(I x_begin, I x_end, I y_begin, I y_end, std::true_type)
+   {
+      typedef typename std::iterator_traits<I>::value_type T;
+
+      size_t n = std::min(x_end - x_begin, y_end - y_begin);
+      if(n == 0) return 0;
+      size_t bytes = simd::mismatch_bytes(reinterpret_cast<const uint8_t *>(&*x_begin), reinterpret_cast<const uint8_t *>(&*y_begin),
+         n * sizeof(T));
+      return bytes / sizeof(T);
+   }
+
+   template<typename I>
+   int_fast64_t common_prefix(I x_begin, I x_end, I y_begin, I y_end)
+   {
+      return common_prefix(x_begin, x_end, y_begin, y_end, is_contiguous_integral<I>());
+   }
+
+   // The number of equal elements at the end of x and y
+
+   template<typename I>
+   int_fast64_t common_suffix(I x_begin, I x_end, I y_begin, I y_end, std::false_type)
+   {
+      int_fast64_t length = 0;
+      for(; x_end != x_begin && y_end != y_begin && *(x_end - 1) == *(y_end - 1); x_end--, y_end--) length++;
+      return length;
+   }
+
+   template<typename I>
+   int_fast64_t common_suffix(I x_begin, I x_end, I y_begin, I y_end, std::true_type)
+   {
+      typedef typename std::iterator_traits<I>::value_type T;
+
+      size_t n = std::min(x_end - x_begin, y_end - y_begin);
+      if(n == 0) return 0;
+      size_t bytes = simd::mismatch_bytes_reverse(reinterpret_cast<const uint8_t *>(&*(x_end - n)),
+         reinterpret_cast<const uint8_t *>(&*(y_end - n)), n * sizeof(T));
+      return bytes / sizeof(T);
+   }
+
+   template<typename I>
+   int_fast64_t common_suffix(I x_begin, I x_end, I y_begin, I y_end)
+   {
+      return common_suffix(x_begin, x_end, y_begin, y_end, is_contiguous_integral<I>());
+   }
+
+   // The hash of every k-mer of x with its offset, sorted by hash
+
+   template<typename I>
+   std::vector<std::pair<uint64_t, int_fast64_t>> kmer_hashes(I x_begin, int_fast64_t x_size, int_fast64_t k)
+   {
+      typedef typename std::iterator_traits<I>::value_type T;
+
+      const uint64_t base = 0x100000001b3ULL;
+      uint64_t high = 1;
+      for(int_fast64_t i = 1; i < k; i++) high *= base;
+
+      std::hash<T> hasher;
+      std::vector<std::pair<uint64_t, int_fast64_t>> hashes;
+      hashes.reserve(std::max<int_fast64_t>(0, x_size - k + 1));
+
+      uint64_t h = 0;
+      for(int_fast64_t i = 0; i < x_size; i++) {
+         if(i >= k) h -= high * hasher(x_begin[i - k]);
+         h = h * base + hasher(x_begin[i]);
+         if(i >= k - 1) hashes.emplace_back(h, i - k + 1);
+      }
+      std::sort(hashes.begin(), hashes.end());
+      return hashes;
+   }
+
+   // Maximal exact matches around the k-mers found once in x and once in y, the longest chain of them increasing in
+   // both with overlaps trimmed off. The iterators must be random access.
+
+   template<typename I>
+   std::vector<nw_anchor> find_anchors(I x_begin, I x_end, I y_begin, I y_end, int_fast64_t k = 32)
+   {
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      std::vector<nw_anchor> anchors;
+      if(k < 1 || x_size < k || y_size < k) return anchors;
+
+      auto x_hashes = kmer_hashes(x_begin, x_size, k);
+      auto y_hashes = kmer_hashes(y_begin, y_size, k);
+
+      // k-mers unique to both, checked against hash collisions
+      std::vector<nw_anchor> seeds;
+      for(size_t a = 0, b = 0; a < x_hashes.size() && b < y_hashes.size(); ) {
+         uint64_t h = x_hashes[a].first;
+         if(h < y_hashes[b].first) { a++; continue; }
+         if(h > y_hashes[b].first) { b++; continue; }
+         size_t a_end = a, b_end = b;
+         while(a_end < x_hashes.size() && x_hashes[a_end].first == h) a_end++;
+         while(b_end < y_hashes.size() && y_hashes[b_end].first == h) b_end++;
+         if(a_end - a == 1 && b_end - b == 1) {
+            int_fast64_t i = x_hashes[a].second, j = y_hashes[b].second;
+            if(std::equal(x_begin + i, x_begin + i + k, y_begin + j)) seeds.push_back(nw_anchor{ i, j, k });
+         }
+         a = a_end;
+         b = b_end;
+      }
+      std::sort(seeds.begin(), seeds.end(), [](const nw_anchor &s, const nw_anchor &t) { return s.x < t.x || (s.x == t.x && s.y < t.y); });
+
+      // extend each seed, a seed inside the match already found on its diagonal adds nothing
+      std::vector<nw_anchor> matches;
+      std::unordered_map<int_fast64_t, int_fast64_t> diagonal_end;
+      for(auto &seed : seeds) {
+         auto found = diagonal_end.find(seed.y - seed.x);
+         if(found != diagonal_end.end() && seed.x < found->second) continue;
+         int_fast64_t left = common_suffix(x_begin, x_begin + seed.x, y_begin, y_begin + seed.y);
+         int_fast64_t right = common_prefix(x_begin + seed.x, x_end, y_begin + seed.y, y_end);
+         matches.push_back(nw_anchor{ seed.x - left, seed.y - left, left + right });
+         diagonal_end[seed.y - seed.x] = seed.x + right;
+      }
+      std::sort(matches.begin(), matches.end(), [](const nw_anchor &s, const nw_anchor &t) { return s.x < t.x || (s.x == t.x && s.y < t.y); });
+
+      // longest increasing run of the y offsets, patience sorting
+      std::vector<int_fast64_t> tails, previous(matches.size(), -1);
+      for(size_t m = 0; m < matches.size(); m++) {
+         auto pile = std::lower_bound(tails.begin(), tails.end(), matches[m].y,
+            [&matches](int_fast64_t t, int_fast64_t y) { return matches[t].y < y; });
+         if(pile != tails.begin()) previous[m] = *(pile - 1);
+         if(pile == tails.end()) tails.push_back(m);
+         else *pile = m;
+      }
+      std::vector<nw_anchor> chain(tails.size());
+      int_fast64_t m = tails.empty() ? -1 : tails.back();
+      for(auto c = chain.rbegin(); c != chain.rend(); c++, m = previous[m]) *c = matches[m];
+
+      // matches may overlap the one before them in x or y, the overlap is cut from the later one
+      for(auto &anchor : chain) {
+         if(!anchors.empty()) {
+            const nw_anchor &last = anchors.back();
+            int_fast64_t overlap = std::max<int_fast64_t>(0, std::max(last.x + last.length - anchor.x, last.y + last.length - anchor.y));
+            anchor.x += overlap;
+            anchor.y += overlap;
+            anchor.length -= overlap;
+         }
+         if(anchor.length > 0) anchors.push_back(anchor);
+      }
+      return anchors;
+   }
+
+   // The best score of aligning x and y through every anchor
+
+   template<typename I, typename F>
+   int_fast64_t anchored_score(I x_begin, I x_end, I y_begin, I y_end, const std::vector<nw_anchor> &anchors, F &&score_function,
+      typename PP<F, I>::type ID)
+   {
+      int_fast64_t score = 0, i = 0, j = 0;
+      for(auto &anchor : anchors) {
+         score += nwScore(x_begin + i, x_begin + anchor.x, y_begin + j, y_begin + anchor.y, score_function, ID).back();
+         for(auto x_cur = x_begin + anchor.x; x_cur != x_begin + anchor.x + anchor.length; x_cur++) score += score_function(*x_cur, *x_cur);
+         i = anchor.x + anchor.length;
+         j = anchor.y + anchor.length;
+      }
+      return score + nwScore(x_begin + i, x_end, y_begin + j, y_end, score_function, ID).back();
+   }
+
+   // The best score of aligning x and y, found with banded sweeps under the assumptions of the banded engines
+
+   template<typename I, typename F>
+   int_fast64_t banded_score(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID)
+   {
+      typedef typename PP<F, I>::type P;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      std::vector<P> top(y_size + 1), bottom(y_size + 1);
+      int_fast64_t k = nw_band_search(x_begin, x_end, y_begin, y_end, score_function, ID, 32, top.data(), bottom.data());
+      return nw_banded_score_row(x_begin, x_end, y_begin, y_end, score_function, ID, nw_band_around(x_size, y_size, k),
+         top.data(), bottom.data())[y_size];
+   }
+
+   // Hirschberg on only the pieces of x and y between exact matches: the shared prefix and suffix, and in ANCHOR_EXACT
+   // mode the k-mer anchors only when they are on an optimal path, in ANCHOR_HEURISTIC mode always. The iterators
+   // must be random access. workspace is used as it is by Hirschberg for every piece.
+
+   template<typename I, typename BI, typename F>
+   void AnchoredHirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function,
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> &workspace,
+      typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-',
+      anchor_mode mode = ANCHOR_EXACT, int_fast64_t k = 32)
+   {
+      int_fast64_t prefix = common_prefix(x_begin, x_end, y_begin, y_end);
+      int_fast64_t suffix = common_suffix(x_begin + prefix, x_end, y_begin + prefix, y_end);
+
+      w_back = std::copy(x_begin, x_begin + prefix, w_back);
+      z_back = std::copy(y_begin, y_begin + prefix, z_back);
+
+      I x_core = x_begin + prefix, x_core_end = x_end - suffix;
+      I y_core = y_begin + prefix, y_core_end = y_end - suffix;
+
+      std::vector<nw_anchor> anchors = find_anchors(x_core, x_core_end, y_core, y_core_end, k);
+      if(mode == ANCHOR_EXACT && !anchors.empty() &&
+         anchored_score(x_core, x_core_end, y_core, y_core_end, anchors, score_function, ID) <
+         banded_score(x_core, x_core_end, y_core, y_core_end, score_function, ID)) {
+         anchors.clear();
+      }
+
+      int_fast64_t i = 0, j = 0;
+      for(auto &anchor : anchors) {
+         Hirschberg(x_core + i, x_core + anchor.x, y_core + j, y_core + anchor.y, w_back, z_back, score_function, workspace, ID, deleted_value);
+         w_back = std::copy(x_core + anchor.x, x_core + anchor.x + anchor.length, w_back);
+         z_back = std::copy(y_core + anchor.y, y_core + anchor.y + anchor.length, z_back);
+         i = anchor.x + anchor.length;
+         j = anchor.y + anchor.length;
+      }
+      Hirschberg(x_core + i, x_core_end, y_core + j, y_core_end, w_back, z_back, score_function, workspace, ID, deleted_value);
+
+      w_back = std::copy(x_end - suffix, x_end, w_back);
+      z_back = std::copy(y_end - suffix, y_end, z_back);
+   }
+
+   template<typename I, typename BI, typename F>
+   void AnchoredHirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function,
+      typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-',
+      anchor_mode mode = ANCHOR_EXACT, int_fast64_t k = 32)
+   {
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> workspace;
+      AnchoredHirschberg(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, workspace, ID, deleted_value, mode, k);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_anchor_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_anchor_suite(void)
+   {
+      return 0;
+   }
+
+   // the score of an alignment, or a very low one if removing the gaps doesn't give back x and y
+
+   template<typename F>
+   int_fast64_t anchor_check(const std::string &x, const std::string &y, const std::vector<std::string> &result, F &&score_function, int ID)
+   {
+      std::string w, z;
+      int_fast64_t score = 0;
+      if(result[0].size() != result[1].size()) return INT32_MIN;
+      for(size_t i = 0; i < result[0].size(); i++) {
+         if(result[0][i] != '-') w.push_back(result[0][i]);
+         if(result[1][i] != '-') z.push_back(result[1][i]);
+         score += result[0][i] == '-' || result[1][i] == '-' ? ID : score_function(result[0][i], result[1][i]);
+      }
+      return w == x && z == y ? score : INT32_MIN;
+   }
+
+   void anchor_test(void)
+   {
+      // long enough for the vector compares, and one which can't use them
+      std::string a(100, 'A'), b(100, 'A');
+      b[70] = 'C';
+      CU_ASSERT(common_prefix(a.begin(), a.end(), b.begin(), b.end()) == 70);
+      CU_ASSERT(common_suffix(a.begin(), a.end(), b.begin(), b.end()) == 29);
+      std::vector<uint64_t> u(50, 7), v(60, 7);
+      u[3] = 1;
+      CU_ASSERT(common_prefix(u.begin(), u.end(), v.begin(), v.end()) == 3);
+      CU_ASSERT(common_suffix(u.begin(), u.end(), v.begin(), v.end()) == 46);
+      std::vector<std::string> s = { "a", "b", "c" }, t = { "a", "b", "d" };
+      CU_ASSERT(common_prefix(s.begin(), s.end(), t.begin(), t.end()) == 2);
+
+      // matches split by substitutions, the last is shorter than k
+      std::string x = "GATTACAGATTACA" "CCCCGGGGTTTT" "ACGTTGCA";
+      std::string y = "GATTACAGATTACT" "CCCCGGGGTTTT" "TCGTTGCA";
+      auto anchors = find_anchors(x.begin(), x.end(), y.begin(), y.end(), 8);
+      CU_ASSERT(anchors.size() == 2 && anchors[0].x == 0 && anchors[0].y == 0 && anchors[0].length == 13);
+      CU_ASSERT(anchors.size() == 2 && anchors[1].x == 14 && anchors[1].y == 14 && anchors[1].length == 12);
+
+      // the same score as Hirschberg in the exact mode and a valid alignment in the heuristic one
+      x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAAATTCACATCTTTACAGAACTT"
+          "TAGCAACTGTCTGCCCAACTCTTGCACAACACAAGTACCTAATCATAGTTTATCTCACAGACAGCCTGAGACAGTTCTTACGGAAACACCCCAGGACACAATTGAATTAAACAGATTG";
+      y = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAAATTCACATCTTTACAGAACTT"
+          "TAGCAACTGTCTGCCCAACTCTTGCACAACACAAGTACCTAATCATAGTTTATCTGAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTG";
+      y[30] = 'G';
+      y.erase(90, 3);
+      int_fast64_t best = nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one).back();
+
+      for(anchor_mode mode : { ANCHOR_EXACT, ANCHOR_HEURISTIC }) {
+         std::vector<std::string> result(2, std::string());
+         AnchoredHirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+            scoring::plus_minus_one, -1, '-', mode, 16);
+         int_fast64_t score = anchor_check(x, y, result, scoring::plus_minus_one, -1);
+         CU_ASSERT(mode == ANCHOR_EXACT ? score == best : score > INT32_MIN);
+         if(mode == ANCHOR_EXACT && score != best) {
+            std::cout << std::endl;
+            std::cout << "result[0] = " << result[0] << std::endl;
+            std::cout << "result[1] = " << result[1] << std::endl;
+         }
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // ANCHOR_HPP
@@ -0,0 +1,443 @@
+#ifndef BANDED_HPP
+#define BANDED_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+
+namespace stringAlgorithms {
+
+   // Banded Needleman-Wunsch
+   //
+   // Only the cells with lo <= j - i <= hi are computed, for a band of k diagonals either side of the diagonals from
+   // (0, 0) to (x_size, y_size) that is O(k * x_size) time instead of O(x_size * y_size). The band is doubled until
+   // the best path inside it provably beats anything that leaves it (Ukkonen): a path which leaves the band has at
+   // least |y_size - x_size| + 2 * (k + 1) gaps so it scores at most (x_size + y_size - gaps) / 2 matches of
+   // max_match_score() plus gaps * ID. This assumes no substitution scores more than the better of its two matches.
+   //
+   // The iterators must be random access.
+
+   struct nw_band {
+      int_fast64_t lo, hi;
+
+      // the first and last column of row i inside the band
+      int_fast64_t first(int_fast64_t i) const { return std::max<int_fast64_t>(0, i + lo); }
+      int_fast64_t last(int_fast64_t i, int_fast64_t y_size) const { return std::min(y_size, i + hi); }
+
+      int_fast64_t width() const { return hi - lo + 1; }
+
+      // the same diagonals seen from a sub-problem which starts at (i, j)
+      nw_band from(int_fast64_t i, int_fast64_t j) const { return nw_band{ lo - (j - i), hi - (j - i) }; }
+
+      // the same diagonals seen from the far corner of an x_size x y_size problem walked backwards
+      nw_band reversed(int_fast64_t x_size, int_fast64_t y_size) const { return nw_band{ y_size - x_size - hi, y_size - x_size - lo }; }
+   };
+
+   // The band of k diagonals either side of the diagonals from (0, 0) to (x_size, y_size), clipped to the matrix
+
+   inline nw_band nw_band_around(int_fast64_t x_size, int_fast64_t y_size, int_fast64_t k) {
+      return nw_band{ std::max(-x_size, std::min<int_fast64_t>(0, y_size - x_size) - k),
+         std::min(y_size, std::max<int_fast64_t>(0, y_size - x_size) + k) };
+   }
+
+   // Whether score, the best score inside nw_band_around(x_size, y_size, k), is the best score of the whole matrix
+
+   template<typename P>
+   bool nw_band_exact(P score, int_fast64_t x_size, int_fast64_t y_size, int_fast64_t k, P match, P ID)
+   {
+      int_fast64_t gaps = std::abs(y_size - x_size) + 2 * (k + 1);
+      if(gaps > x_size + y_size) return true;
+
+      // the bound is linear in the number of gaps so the worst case is at one end of the range
+      double fewest = (x_size + y_size - gaps) / 2.0 * match + gaps * double(ID);
+      double most = (x_size + y_size) * double(ID);
+      return double(score) >= std::max(fewest, most);
+   }
+
+   // nw_banded_sweep computes the band of one row of the score matrix from the band of the row above it
+   //
+   //    sweep.first_row(top);
+   //    for each x: sweep(i, x, top, bottom); swap(top, bottom);
+   //
+   // top and bottom must hold y_size + 1 scores but only the band of each is read or written. If move_row is given
+   // the moves are stored in it by their offset j - i - lo from the start of the band.
+
+   template<typename I, typename F>
+   class nw_banded_sweep {
+   public:
+      typedef typename PP<F, I>::type                       P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+      typedef typename std::remove_reference<F>::type       F_type;
+
+      nw_banded_sweep(I y_begin, I y_end, F_type &score_function, P ID, nw_band band) :
+         y_begin_(y_begin), y_size_(std::distance(y_begin, y_end)), score_function_(score_function), ID_(ID), band_(band) {}
+
+      void first_row(P *top, uint8_t *move_row = nullptr) const {
+         int_fast64_t last = band_.last(0, y_size_);
+         top[0] = 0;
+         if(move_row) traceback_plane::set(move_row, -band_.lo, NW_DIAG);
+         for(int_fast64_t j = 1; j <= last; j++) {
+            top[j] = top[j-1] + ID_;
+            if(move_row) traceback_plane::set(move_row, j - band_.lo, NW_LEFT);
+         }
+      }
+
+      void operator()(int_fast64_t i, const I_type &x, const P *top, P *bottom, uint8_t *move_row = nullptr) {
+         int_fast64_t first = band_.first(i), last = band_.last(i, y_size_);
+         int_fast64_t top_first = band_.first(i - 1), top_last = band_.last(i - 1, y_size_);
+         int_fast64_t offset = i + band_.lo;
+
+         // the cells in [inner_first, inner_last] have all three neighbours inside the band
+         int_fast64_t inner_first = std::max(first, top_first) + 1, inner_last = std::min(last, top_last);
+
+         int_fast64_t j = first;
+         if(j == 0) {
+            bottom[0] = top[0] + ID_;
+            if(move_row) traceback_plane::set(move_row, -offset, NW_UP);
+            j++;
+         }
+         for(; j <= last && j < inner_first; j++) edge(j, x, first, top_first, top_last, offset, top, bottom, move_row);
+         if(move_row) {
+            for(; j <= inner_last; j++) {
+               P score_sub = top[j-1] + score_function_(x, y_begin_[j-1]);
+               P score_del = top[j] + ID_;
+               P score_ins = bottom[j-1] + ID_;
+               if(score_sub >= score_del && score_sub >= score_ins) {
+                  bottom[j] = score_sub;
+                  traceback_plane::set(move_row, j - offset, NW_DIAG);
+               } else if(score_del >= score_ins) {
+                  bottom[j] = score_del;
+                  traceback_plane::set(move_row, j - offset, NW_UP);
+               } else {
+                  bottom[j] = score_ins;
+                  traceback_plane::set(move_row, j - offset, NW_LEFT);
+               }
+            }
+         } else {
+            for(; j <= inner_last; j++) {
+               P score_sub = top[j-1] + score_function_(x, y_begin_[j-1]);
+               P score_del = top[j] + ID_;
+               P score_ins = bottom[j-1] + ID_;
+               bottom[j] = std::max({score_sub, score_del, score_ins});
+            }
+         }
+         for(; j <= last; j++) edge(j, x, first, top_first, top_last, offset, top, bottom, move_row);
+      }
+
+   private:
+      // a cell on the edge of the band, only the neighbours inside the band are used
+      // the same tie break as nw_traceback_matrix: up-left, then up, then left
+      void edge(int_fast64_t j, const I_type &x, int_fast64_t first, int_fast64_t top_first, int_fast64_t top_last, int_fast64_t offset,
+         const P *top, P *bottom, uint8_t *move_row)
+      {
+         P       best = 0;
+         nw_move move = NW_DIAG;
+         bool    found = false;
+         if(j - 1 >= top_first) {
+            best = top[j-1] + score_function_(x, y_begin_[j-1]);
+            found = true;
+         }
+         if(j <= top_last && (!found || top[j] + ID_ > best)) {
+            best = top[j] + ID_;
+            move = NW_UP;
+            found = true;
+         }
+         if(j - 1 >= first && (!found || bottom[j-1] + ID_ > best)) {
+            best = bottom[j-1] + ID_;
+            move = NW_LEFT;
+         }
+         bottom[j] = best;
+         if(move_row) traceback_plane::set(move_row, j - offset, move);
+      }
+
+      I              y_begin_;
+      int_fast64_t   y_size_;
+      F_type         &score_function_;
+      P              ID_;
+      nw_band        band_;
+   };
+
+   // The band of the last row of the score matrix computed in the caller's rows, as nw_score_row()
+   // band must contain the diagonals 0 and y_size - x_size
+
+   template<typename I, typename F>
+   typename PP<F, I>::type *
+   nw_banded_score_row(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID, nw_band band,
+      typename PP<F, I>::type *top, typename PP<F, I>::type *bottom)
+   {
+      nw_banded_sweep<I, F> sweep(y_begin, y_end, score_function, ID, band);
+
+      sweep.first_row(top);
+      int_fast64_t i = 1;
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++, i++) {
+         sweep(i, *x_cur, top, bottom);
+         std::swap(top, bottom);
+      }
+      return top;
+   }
+
+   // Fill moves for the cells of band, row i of moves holds the cells j - i - band.lo for 0 <= j - i - band.lo < band.width()
+   // top and bottom hold y_size + 1 scores, returns the score of the alignment
+
+   template<typename I, typename F>
+   typename PP<F, I>::type
+   nw_banded_traceback_matrix(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, traceback_plane &moves, nw_band band,
+      typename PP<F, I>::type ID, typename PP<F, I>::type *top, typename PP<F, I>::type *bottom)
+   {
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      moves.resize(x_size + 1, band.width());
+
+      nw_banded_sweep<I, F> sweep(y_begin, y_end, score_function, ID, band);
+
+      sweep.first_row(top, moves.row(0));
+      int_fast64_t i = 1;
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++, i++) {
+         sweep(i, *x_cur, top, bottom, moves.row(i));
+         std::swap(top, bottom);
+      }
+      return top[y_size];
+   }
+
+   // Walk a traceback_plane filled by nw_banded_traceback_matrix() pushing the alignment onto w and z backwards
+
+   template<typename I, typename T>
+   void nw_banded_traceback_reversed(const traceback_plane &moves, nw_band band, I x_begin, I x_end, I y_begin, I y_end,
+      std::vector<T> &w, std::vector<T> &z, const T deleted_value)
+   {
+      int_fast64_t   i = std::distance(x_begin, x_end);
+      int_fast64_t   j = std::distance(y_begin, y_end);
+
+      auto x_cur = x_end;
+      auto y_cur = y_end;
+
+      while(i != 0 || j != 0) {
+         switch(moves(i, j - i - band.lo)) {
+            case NW_DIAG:
+               --x_cur; --y_cur;
+               w.push_back(*x_cur);
+               z.push_back(*y_cur);
+               i--; j--;
+               break;
+            case NW_UP:
+               --x_cur;
+               w.push_back(*x_cur);
+               z.push_back(deleted_value);
+               i--;
+               break;
+            default:
+               --y_cur;
+               w.push_back(deleted_value);
+               z.push_back(*y_cur);
+               j--;
+               break;
+         }
+      }
+   }
+
+   // The smallest k, starting from k and doubling, for which the band around the problem is known to hold an optimal
+   // path, found with score-only sweeps in the caller's rows
+
+   template<typename I, typename F>
+   int_fast64_t nw_band_search(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID, int_fast64_t k,
+      typename PP<F, I>::type *top, typename PP<F, I>::type *bottom)
+   {
+      typedef typename PP<F, I>::type P;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      P match = max_match_score(x_begin, x_end, y_begin, y_end, score_function);
+
+      for(k = std::max<int_fast64_t>(1, k);; k *= 2) {
+         if(2 * (k + 1) > x_size + y_size - std::abs(y_size - x_size)) return k;
+         P score = nw_banded_score_row(x_begin, x_end, y_begin, y_end, score_function, ID, nw_band_around(x_size, y_size, k), top, bottom)[y_size];
+         if(nw_band_exact(score, x_size, y_size, k, match, ID)) return k;
+      }
+   }
+
+   // Needleman-Wunsch computing only a band of k diagonals either side of the main ones, doubling k until the result
+   // is exact. The alignment has the best score but where there are ties it may differ from NeedlemanWunsch's.
+
+   template<typename I, typename BI, typename F>
+   void BandedNeedlemanWunsch(I x_begin, I x_end, I y_begin, I y_end, BI w_back, BI z_back, F &&score_function,
+      typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-', int_fast64_t k = 32)
+   {
+      typedef typename PP<F, I>::type                       P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      P match = max_match_score(x_begin, x_end, y_begin, y_end, score_function);
+
+      std::vector<P>    top(y_size + 1), bottom(y_size + 1);
+      traceback_plane   moves;
+      nw_band           band;
+
+      for(k = std::max<int_fast64_t>(1, k);; k *= 2) {
+         band = nw_band_around(x_size, y_size, k);
+         P score = nw_banded_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, moves, band, ID, top.data(), bottom.data());
+         if(nw_band_exact(score, x_size, y_size, k, match, ID)) break;
+      }
+
+      std::vector<I_type> w, z;
+      nw_banded_traceback_reversed(moves, band, x_begin, x_end, y_begin, y_end, w, z, deleted_value);
+
+      std::copy(w.rbegin(), w.rend(), w_back);
+      std::copy(z.rbegin(), z.rend(), z_back);
+   }
+
+   template<typename I, typename BI, typename F, typename P, typename T>
+   void banded_hirschberg_step(I x_begin, I x_end, I y_begin, I y_end, BI &w_back, BI &z_back, F &score_function, P ID,
+      const T deleted_value, nw_band band, hirschberg_workspace<P, T> &workspace)
+   {
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      if(x_size == 0) {
+         w_back = std::fill_n(w_back, y_size, deleted_value);
+         z_back = std::copy(y_begin, y_end, z_back);
+      } else if(y_size == 0) {
+         w_back = std::copy(x_begin, x_end, w_back);
+         z_back = std::fill_n(z_back, x_size, deleted_value);
+      } else if(x_size == 1 || y_size == 1 || x_size * band.width() <= workspace.cutoff) {
+         nw_banded_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, workspace.moves, band, ID, workspace.row(0), workspace.row(1));
+         workspace.w.clear();
+         workspace.z.clear();
+         nw_banded_traceback_reversed(workspace.moves, band, x_begin, x_end, y_begin, y_end, workspace.w, workspace.z, deleted_value);
+         w_back = std::copy(workspace.w.rbegin(), workspace.w.rend(), w_back);
+         z_back = std::copy(workspace.z.rbegin(), workspace.z.rend(), z_back);
+      } else {
+         auto x_mid = x_size / 2;
+
+         P *ScoreL = nw_banded_score_row(x_begin, x_begin + x_mid, y_begin, y_end, score_function, ID, band,
+            workspace.row(0), workspace.row(1));
+         P *ScoreR = nw_banded_score_row(std::reverse_iterator<I>(x_end), std::reverse_iterator<I>(x_begin + x_mid),
+            std::reverse_iterator<I>(y_end), std::reverse_iterator<I>(y_begin), score_function, ID, band.reversed(x_size, y_size),
+            workspace.row(2), workspace.row(3));
+
+         // both rows hold the same columns of the middle row, the optimal path crosses it at one of them
+         int_fast64_t first = band.first(x_mid), last = band.last(x_mid, y_size);
+         auto y_mid = first + partition(ScoreL + first, ScoreL + last + 1, ScoreR + y_size - last, ScoreR + y_size - first + 1);
+
+         banded_hirschberg_step(x_begin, x_begin + x_mid, y_begin, y_begin + y_mid, w_back, z_back, score_function, ID, deleted_value,
+            band, workspace);
+         banded_hirschberg_step(x_begin + x_mid, x_end, y_begin + y_mid, y_end, w_back, z_back, score_function, ID, deleted_value,
+            band.from(x_mid, y_mid), workspace);
+      }
+   }
+
+   // Hirschberg computing only a band of k diagonals either side of the main ones, the band is found by doubling k
+   // with score-only sweeps and then every split is restricted to it, O(k * x_size) time and O(y_size) space.
+   // The alignment has the best score but where there are ties it may differ from Hirschberg's.
+   // workspace is used as it is by Hirschberg, a sub-problem is solved directly once its band has cutoff cells or fewer
+
+   template<typename I, typename BI, typename F>
+   void BandedHirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function,
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> &workspace,
+      typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-', int_fast64_t k = 32)
+   {
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      workspace.reserve(y_size);
+
+      k = nw_band_search(x_begin, x_end, y_begin, y_end, score_function, ID, k, workspace.row(0), workspace.row(1));
+
+      banded_hirschberg_step(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value,
+         nw_band_around(x_size, y_size, k), workspace);
+   }
+
+   template<typename I, typename BI, typename F>
+   void BandedHirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function,
+      typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-', int_fast64_t k = 32)
+   {
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> workspace;
+      BandedHirschberg(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, workspace, ID, deleted_value, k);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_banded_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_banded_suite(void)
+   {
+      return 0;
+   }
+
+   // the score of an alignment and whether removing the gaps gives back x and y
+
+   template<typename F>
+   bool banded_check(const std::string &x, const std::string &y, const std::vector<std::string> &result, F &&score_function,
+      int16_t ID, int16_t expected)
+   {
+      if(result[0].size() != result[1].size()) return false;
+      std::string x_back, y_back;
+      int score = 0;
+      for(size_t k = 0; k < result[0].size(); k++) {
+         if(result[0][k] == '-') score += ID;
+         else if(result[1][k] == '-') score += ID;
+         else score += score_function(result[0][k], result[1][k]);
+         if(result[0][k] != '-') x_back += result[0][k];
+         if(result[1][k] != '-') y_back += result[1][k];
+      }
+      return x_back == x && y_back == y && score == expected;
+   }
+
+   void banded_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+      std::string near = x.substr(0, 30) + "C" + x.substr(31, 20) + x.substr(52);
+
+      auto three_two = [](const char &a, const char &b) -> int16_t { return a == b ? 3 : -2; };
+
+      // a cutoff of 0 so BandedHirschberg splits all the way down
+      hirschberg_workspace<int16_t, char> workspace(0);
+
+      // k = 1 so that the near-identical pair is done in the first band and the others have to grow it
+      std::vector<std::pair<std::string, std::string>> pairs = { { x, y }, { y, x }, { x, near }, { "GATTACA", "GCATGCU" }, { "A", "" } };
+      for(auto &p : pairs) {
+         int16_t expected = nwScore(p.first.begin(), p.first.end(), p.second.begin(), p.second.end(), three_two, -3).back();
+
+         std::vector<std::string> result(2, std::string());
+         BandedNeedlemanWunsch(p.first.begin(), p.first.end(), p.second.begin(), p.second.end(), std::back_inserter(result[0]),
+            std::back_inserter(result[1]), three_two, -3, '-', 1);
+         CU_ASSERT(banded_check(p.first, p.second, result, three_two, -3, expected));
+
+         std::vector<std::string> banded(2, std::string());
+         BandedHirschberg(p.first.begin(), p.first.end(), p.second.begin(), p.second.end(), std::back_inserter(banded[0]),
+            std::back_inserter(banded[1]), three_two, workspace, -3, '-', 1);
+         CU_ASSERT(banded_check(p.first, p.second, banded, three_two, -3, expected));
+         if(!banded_check(p.first, p.second, banded, three_two, -3, expected)) {
+            std::cout << std::endl;
+            std::cout << "result[0] = " << banded[0] << std::endl;
+            std::cout << "result[1] = " << banded[1] << std::endl;
+         }
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // BANDED_HPP
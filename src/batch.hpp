@@ -0,0 +1,355 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "simd.hpp"
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+
+namespace stringAlgorithms {
+
+   // Needleman-Wunsch for many pairs at once
+   //
+   // The pairs are given as a range of std::pair (or anything with first and second) of containers. One pair goes in
+   // each SIMD lane (8 with SSE2, 16 with AVX2) so a row of cells is computed for every pair of the group at once.
+   // The pairs are grouped by length to keep the padding down, a lane's score is picked up when its row and column
+   // are reached and anything computed past them is ignored. The scores, and the alignments if they are asked for,
+   // come back in the order the pairs were given and are the same as NeedlemanWunsch's. Pairs that can't use SIMD
+   // (see nw_simd_eligible) are done one at a time.
+
+   template<typename PI>
+   struct batch_types {
+      typedef typename std::iterator_traits<PI>::value_type    pair_type;
+      typedef typename pair_type::first_type                   C;
+      typedef typename C::const_iterator                       I;
+      typedef typename std::iterator_traits<I>::value_type     T;
+   };
+
+   template<typename PI, typename F, typename P, typename C, typename T>
+   void batch_needleman_wunsch(PI pairs_begin, PI pairs_end, F &score_function, P ID, std::vector<P> &scores,
+      std::vector<std::pair<C, C>> *alignments, const T deleted_value, std::false_type)
+   {
+      int_fast64_t k = 0;
+      for(auto pair_cur = pairs_begin; pair_cur != pairs_end; pair_cur++, k++) {
+         const C &x = pair_cur->first, &y = pair_cur->second;
+         if(alignments) {
+            traceback_plane moves;
+            scores[k] = nw_traceback_matrix(x.begin(), x.end(), y.begin(), y.end(), score_function, moves, ID);
+            nw_traceback(moves, x.begin(), x.end(), y.begin(), y.end(), std::back_inserter((*alignments)[k].first),
+               std::back_inserter((*alignments)[k].second), deleted_value);
+         } else {
+            std::vector<P> top(y.size() + 1), bottom(y.size() + 1);
+            scores[k] = nw_score_row(x.begin(), x.end(), y.begin(), y.end(), score_function, ID, top.data(), bottom.data())[y.size()];
+         }
+      }
+   }
+
+#if STRINGALGORITHMS_SIMD
+
+   // groups whose x's have at most this many distinct symbols select their scores with masks
+   const int batch_mask_symbols = 8;
+
+   template<typename PI, typename F, typename C, typename T>
+   void batch_needleman_wunsch(PI pairs_begin, PI pairs_end, F &score_function, int16_t ID, std::vector<int16_t> &scores,
+      std::vector<std::pair<C, C>> *alignments, const T deleted_value, std::true_type)
+   {
+      typedef simd::i16                            V;
+      typedef typename batch_types<PI>::pair_type  pair_type;
+      typedef typename batch_types<PI>::I          I;
+
+      const int L = V::lanes;
+
+      std::vector<const pair_type *> pairs;
+      for(auto pair_cur = pairs_begin; pair_cur != pairs_end; pair_cur++) pairs.push_back(&*pair_cur);
+      int_fast64_t count = pairs.size();
+
+      // similar lengths go in the same group
+      std::vector<int_fast64_t> order(count);
+      for(int_fast64_t k = 0; k < count; k++) order[k] = k;
+      std::sort(order.begin(), order.end(), [&](int_fast64_t a, int_fast64_t b) {
+         auto size_a = std::make_pair(pairs[a]->first.size(), pairs[a]->second.size());
+         auto size_b = std::make_pair(pairs[b]->first.size(), pairs[b]->second.size());
+         return size_a < size_b || (size_a == size_b && a < b);
+      });
+
+      // score(a, b) for every pair of symbols which appear, a lane gathers its score of x[i] against y[j] from here
+      bool seen[256] = {};
+      for(auto p : pairs) {
+         for(auto c : p->first) seen[static_cast<unsigned char>(c)] = true;
+         for(auto c : p->second) seen[static_cast<unsigned char>(c)] = true;
+      }
+      std::vector<int16_t> table(256 * 256, 0);
+      for(int a = 0; a < 256; a++) {
+         if(!seen[a]) continue;
+         for(int b = 0; b < 256; b++) {
+            if(seen[b]) table[a * 256 + b] = score_function(static_cast<T>(a), static_cast<T>(b));
+         }
+      }
+
+      V::type id = V::set1(ID), one = V::set1(1), two = V::set1(2);
+
+      std::vector<unsigned char>    y_lanes;
+      std::vector<int16_t>          top, bottom, sub, profile;
+      std::vector<uint8_t>          moves;
+
+      for(int_fast64_t group = 0; group < count; group += L) {
+         int               used = std::min<int_fast64_t>(L, count - group);
+         int_fast64_t      x_size[L], y_size[L], x_max = 0, y_max = 0;
+         I                 x_cur[L];
+         const int16_t     *rows[L];
+
+         for(int l = 0; l < L; l++) {
+            const pair_type *p = pairs[order[group + std::min(l, used - 1)]];
+            x_size[l] = l < used ? p->first.size() : 0;
+            y_size[l] = l < used ? p->second.size() : 0;
+            x_cur[l] = p->first.begin();
+            x_max = std::max(x_max, x_size[l]);
+            y_max = std::max(y_max, y_size[l]);
+         }
+
+         // y of every lane interleaved, lane l of column j at (j - 1) * L + l
+         y_lanes.assign(y_max * L, 0);
+         for(int l = 0; l < used; l++) {
+            int_fast64_t j = 0;
+            for(auto c : pairs[order[group + l]]->second) y_lanes[j++ * L + l] = static_cast<unsigned char>(c);
+         }
+
+         // when the x's of the group use only a few symbols each gets a profile of its scores against every lane's y
+         // and a row picks its lane's score out of them with masks rather than looking each one up
+         int   symbols = 0;
+         int   symbol_index[256];
+         std::fill(std::begin(symbol_index), std::end(symbol_index), -1);
+         for(int l = 0; l < used && symbols <= batch_mask_symbols; l++) {
+            for(auto c : pairs[order[group + l]]->first) {
+               auto a = static_cast<unsigned char>(c);
+               if(symbol_index[a] < 0) symbol_index[a] = symbols++;
+               if(symbols > batch_mask_symbols) break;
+            }
+         }
+         bool masked = symbols <= batch_mask_symbols;
+         if(masked) {
+            profile.resize(symbols * (y_max + 1) * L);
+            for(int a = 0; a < 256; a++) {
+               if(symbol_index[a] < 0) continue;
+               int16_t *prof = profile.data() + symbol_index[a] * (y_max + 1) * L;
+               for(int_fast64_t j = 1; j <= y_max; j++) {
+                  for(int l = 0; l < L; l++) prof[j * L + l] = table[a * 256 + y_lanes[(j - 1) * L + l]];
+               }
+            }
+         }
+
+         top.resize((y_max + 1) * L);
+         bottom.resize((y_max + 1) * L);
+         sub.resize((y_max + 1) * L);
+         if(alignments) moves.resize((x_max + 1) * (y_max + 1) * (L / 4));
+
+         for(int_fast64_t j = 0; j <= y_max; j++) {
+            for(int l = 0; l < L; l++) top[j * L + l] = simd::saturate16(j * ID);
+         }
+         for(int l = 0; l < used; l++) {
+            if(x_size[l] == 0) scores[order[group + l]] = top[y_size[l] * L + l];
+         }
+
+         for(int_fast64_t i = 1; i <= x_max; i++) {
+            int16_t lane_symbol[L];
+            bool    row_has[batch_mask_symbols + 1] = {};
+            for(int l = 0; l < L; l++) {
+               unsigned char a = 0;
+               lane_symbol[l] = -1;
+               if(i <= x_size[l]) {
+                  a = static_cast<unsigned char>(*x_cur[l]++);
+                  if(masked) row_has[lane_symbol[l] = symbol_index[a]] = true;
+               }
+               rows[l] = table.data() + a * 256;
+            }
+            if(masked) {
+               V::type        lanes = V::load(lane_symbol), mask[batch_mask_symbols + 1];
+               const int16_t  *prof[batch_mask_symbols + 1];
+               int            row_symbols = 0;
+               for(int k = 0; k < symbols; k++) {
+                  if(!row_has[k]) continue;
+                  mask[row_symbols] = V::cmpeq(lanes, V::set1(k));
+                  prof[row_symbols++] = profile.data() + k * (y_max + 1) * L;
+               }
+               int16_t *sub_row = sub.data();
+               std::fill(sub_row + L, sub_row + (y_max + 1) * L, 0);
+               for(int k = 0; k < row_symbols; k++) {
+                  for(int_fast64_t j = L; j <= y_max * L; j += L) {
+                     V::store(sub_row + j, V::bit_or(V::load(sub_row + j), V::bit_and(mask[k], V::load(prof[k] + j))));
+                  }
+               }
+            } else {
+               for(int_fast64_t j = 1; j <= y_max; j++) {
+                  const unsigned char *y_col = y_lanes.data() + (j - 1) * L;
+                  int16_t *sub_col = sub.data() + j * L;
+                  for(int l = 0; l < L; l++) sub_col[l] = rows[l][y_col[l]];
+               }
+            }
+
+            V::type left = V::adds(V::load(top.data()), id);
+            V::store(bottom.data(), left);
+            uint8_t *move_row = alignments ? moves.data() + i * (y_max + 1) * (L / 4) : nullptr;
+            for(int_fast64_t j = 1; j <= y_max; j++) {
+               V::type score_sub = V::adds(V::load(top.data() + (j - 1) * L), V::load(sub.data() + j * L));
+               V::type score_del = V::adds(V::load(top.data() + j * L), id);
+               V::type score_ins = V::adds(left, id);
+               left = V::max(V::max(score_sub, score_del), score_ins);
+               V::store(bottom.data() + j * L, left);
+               if(move_row) {
+                  // the same tie break as nw_traceback_matrix: up-left, then up, then left
+                  V::type is_diag = V::cmpeq(left, score_sub);
+                  V::type is_up = V::bit_andnot(is_diag, V::cmpeq(left, score_del));
+                  V::type move = V::bit_or(V::bit_and(is_up, one), V::bit_andnot(V::bit_or(is_diag, is_up), two));
+                  V::pack_2bit(move, move_row + j * (L / 4));
+               }
+            }
+
+            for(int l = 0; l < used; l++) {
+               if(x_size[l] == i) scores[order[group + l]] = bottom[y_size[l] * L + l];
+            }
+            std::swap(top, bottom);
+         }
+
+         if(!alignments) continue;
+
+         for(int l = 0; l < used; l++) {
+            const pair_type &p = *pairs[order[group + l]];
+            std::pair<C, C> &out = (*alignments)[order[group + l]];
+            int_fast64_t i = x_size[l], j = y_size[l];
+            auto x_back = p.first.end();
+            auto y_back = p.second.end();
+            while(i != 0 || j != 0) {
+               int move = NW_LEFT;
+               if(j == 0) move = NW_UP;
+               else if(i != 0) move = (moves[(i * (y_max + 1) + j) * (L / 4) + l / 4] >> (2 * (l % 4))) & 3;
+               if(move == NW_DIAG) {
+                  out.first.push_back(*--x_back);
+                  out.second.push_back(*--y_back);
+                  i--; j--;
+               } else if(move == NW_UP) {
+                  out.first.push_back(*--x_back);
+                  out.second.push_back(deleted_value);
+                  i--;
+               } else {
+                  out.first.push_back(deleted_value);
+                  out.second.push_back(*--y_back);
+                  j--;
+               }
+            }
+            std::reverse(out.first.begin(), out.first.end());
+            std::reverse(out.second.begin(), out.second.end());
+         }
+      }
+   }
+
+#endif // STRINGALGORITHMS_SIMD
+
+   // The Needleman-Wunsch score of every pair, in the order of the pairs
+
+   template<typename PI, typename F>
+   std::vector<typename PP<F, typename batch_types<PI>::I>::type>
+   batch_alignment_scores(PI pairs_begin, PI pairs_end, F &&score_function, typename PP<F, typename batch_types<PI>::I>::type ID = -1)
+   {
+      typedef typename batch_types<PI>::I    I;
+      typedef typename batch_types<PI>::C    C;
+      typedef typename batch_types<PI>::T    T;
+      typedef typename PP<F, I>::type        P;
+
+      std::vector<P> scores(std::distance(pairs_begin, pairs_end));
+      batch_needleman_wunsch(pairs_begin, pairs_end, score_function, ID, scores, static_cast<std::vector<std::pair<C, C>> *>(nullptr),
+         T('-'), std::integral_constant<bool, nw_simd_eligible<I, F>::value>());
+      return scores;
+   }
+
+   // The Needleman-Wunsch score and alignment of every pair, in the order of the pairs
+   // alignments[k] holds the padded x and y of pair k
+
+   template<typename PI, typename F>
+   std::vector<typename PP<F, typename batch_types<PI>::I>::type>
+   BatchNeedlemanWunsch(PI pairs_begin, PI pairs_end, F &&score_function,
+      std::vector<std::pair<typename batch_types<PI>::C, typename batch_types<PI>::C>> &alignments,
+      typename PP<F, typename batch_types<PI>::I>::type ID = -1, const typename batch_types<PI>::T deleted_value = '-')
+   {
+      typedef typename batch_types<PI>::I    I;
+      typedef typename PP<F, I>::type        P;
+
+      std::vector<P> scores(std::distance(pairs_begin, pairs_end));
+      alignments.assign(scores.size(), typename std::remove_reference<decltype(alignments)>::type::value_type());
+      batch_needleman_wunsch(pairs_begin, pairs_end, score_function, ID, scores, &alignments, deleted_value,
+         std::integral_constant<bool, nw_simd_eligible<I, F>::value>());
+      return scores;
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_batch_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_batch_suite(void)
+   {
+      return 0;
+   }
+
+   void batch_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+
+      // more pairs than lanes, of mixed lengths including empty ones
+      std::vector<std::pair<std::string, std::string>> pairs;
+      for(size_t k = 0; k < 40; k++) pairs.push_back(std::make_pair(x.substr(k, (k * 7) % 50), y.substr((k * 3) % 20, (k * 11) % 45)));
+      pairs.push_back(std::make_pair(std::string("GATTACA"), std::string("GCATGCU")));
+
+      // and enough different symbols that their scores are looked up rather than masked
+      for(size_t k = 0; k < 20; k++) {
+         std::string a = "the quick brown fox jumps over the lazy dog", b = "a quick brown dog jumped over the lazy fox";
+         pairs.push_back(std::make_pair(a.substr(k), b.substr(0, b.size() - k)));
+      }
+
+      auto three_two = [](const char &a, const char &b) -> int16_t { return a == b ? 3 : -2; };
+
+      std::vector<std::pair<std::string, std::string>> alignments;
+      auto scores = BatchNeedlemanWunsch(pairs.begin(), pairs.end(), three_two, alignments, -3);
+      CU_ASSERT(scores == batch_alignment_scores(pairs.begin(), pairs.end(), three_two, -3));
+
+      bool same = scores.size() == pairs.size();
+      for(size_t k = 0; same && k < pairs.size(); k++) {
+         const std::string &a = pairs[k].first, &b = pairs[k].second;
+         std::pair<std::string, std::string> expected;
+         NeedlemanWunsch(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected.first), std::back_inserter(expected.second),
+            three_two, -3);
+         same = scores[k] == nwScore(a.begin(), a.end(), b.begin(), b.end(), three_two, -3).back() && alignments[k] == expected;
+         if(!same) {
+            std::cout << std::endl;
+            std::cout << "result[0] = " << alignments[k].first << std::endl;
+            std::cout << "result[1] = " << alignments[k].second << std::endl;
+         }
+      }
+      CU_ASSERT(same);
+
+      // a score type which can't use SIMD goes one pair at a time
+      auto wide = [](const char &a, const char &b) -> int32_t { return a == b ? 3 : -2; };
+      auto wide_scores = batch_alignment_scores(pairs.begin(), pairs.end(), wide, -3);
+      CU_ASSERT(std::equal(scores.begin(), scores.end(), wide_scores.begin()));
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // BATCH_HPP
@@ -0,0 +1,215 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+#include "nwrow.hpp"
+
+namespace stringAlgorithms {
+
+   // Checkpointed Needleman-Wunsch
+   //
+   // Between NeedlemanWunsch, which keeps 2 bits for every cell, and Hirschberg, which keeps a few rows but computes
+   // the cells about twice over a recursion log(x_size) deep. A score-only sweep keeps every k-th row of scores, then
+   // the traceback goes back a block of k rows at a time: the moves of the block are filled from the row stored above
+   // it, exactly as NeedlemanWunsch fills them, and walked back to that row. Only the columns left of where the path
+   // leaves a block are redone, so for a path near the diagonal about half the cells are computed twice. There's no
+   // recursion, and the alignment is the same one NeedlemanWunsch gives. k is the largest block which fits in a
+   // budget of bytes, with room for the whole plane this is NeedlemanWunsch and with too little it is Hirschberg.
+
+   // The bytes used with blocks of k rows: the stored rows, the moves of one block and two rows of scores
+   // the alignment being built is not counted
+
+   template<typename P>
+   int_fast64_t checkpoint_bytes(int_fast64_t x_size, int_fast64_t y_size, int_fast64_t k)
+   {
+      int_fast64_t stored = std::max<int_fast64_t>(1, (x_size + k - 1) / k);
+      return (stored + 2) * (y_size + 1) * int_fast64_t(sizeof(P)) + (k + 1) * ((y_size + 4) / 4);
+   }
+
+   // The largest block of rows, at most x_size, for which checkpoint_bytes() is within budget, 0 if none is
+
+   template<typename P>
+   int_fast64_t checkpoint_rows(int_fast64_t x_size, int_fast64_t y_size, int_fast64_t budget)
+   {
+      if(x_size == 0 || checkpoint_bytes<P>(x_size, y_size, x_size) <= budget) return std::max<int_fast64_t>(1, x_size);
+
+      // the stored rows shrink and the block grows with k, their sum is smallest around sqrt(x_size * row / plane row)
+      double row = double(y_size + 1) * sizeof(P), plane_row = double((y_size + 4) / 4);
+      int_fast64_t low = std::max<int_fast64_t>(1, std::min<int_fast64_t>(x_size, std::llround(std::sqrt(x_size * row / plane_row))));
+      if(checkpoint_bytes<P>(x_size, y_size, low) > budget) return 0;
+
+      int_fast64_t high = x_size;
+      while(high - low > 1) {
+         int_fast64_t mid = low + (high - low) / 2;
+         if(checkpoint_bytes<P>(x_size, y_size, mid) <= budget) low = mid;
+         else high = mid;
+      }
+      return low;
+   }
+
+   // Needleman-Wunsch in blocks of k rows of moves, the alignment is written to w_back and z_back
+
+   template<typename I, typename BI, typename F>
+   void checkpoint_alignment(I x_begin, I x_end, I y_begin, I y_end, BI &w_back, BI &z_back, F &score_function, typename PP<F, I>::type ID,
+      const typename std::iterator_traits<I>::value_type deleted_value, int_fast64_t k)
+   {
+      typedef typename PP<F, I>::type                       P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+      int_fast64_t blocks = std::max<int_fast64_t>(1, (x_size + k - 1) / k);
+
+      std::vector<P> stored(blocks * (y_size + 1)), top(y_size + 1), bottom(y_size + 1), profile;
+      P *top_row = top.data(), *bottom_row = bottom.data();
+
+      // rows 0, k, 2k, ... up to the start of the last block
+      nw_row_sweep<I, F> sweep(y_begin, y_end, score_function, ID, &profile);
+      sweep.first_row(stored.data());
+      std::copy(stored.begin(), stored.begin() + y_size + 1, top_row);
+      auto x_cur = x_begin;
+      for(int_fast64_t i = 1; i <= (blocks - 1) * k; i++, x_cur++) {
+         sweep(*x_cur, top_row, bottom_row);
+         std::swap(top_row, bottom_row);
+         if(i % k == 0) std::copy(top_row, top_row + y_size + 1, stored.begin() + (i / k) * (y_size + 1));
+      }
+
+      std::vector<I_type>  w, z;
+      traceback_plane      moves;
+      int_fast64_t         i = x_size, j = y_size;
+
+      for(int_fast64_t b = blocks - 1; b >= 0; b--) {
+         int_fast64_t first = b * k;
+
+         // the path never goes right, so only the columns up to where it leaves the block are needed
+         moves.resize(i - first + 1, j + 1);
+         std::copy(stored.begin() + b * (y_size + 1), stored.begin() + b * (y_size + 1) + j + 1, top.begin());
+         nw_traceback_rows(x_begin + first, x_begin + i, y_begin, y_begin + j, score_function, moves, ID, top.data(), bottom.data(),
+            &profile, std::integral_constant<bool, nw_simd_eligible<I, F>::value>());
+
+         for(; i > first; ) {
+            switch(moves(i - first, j)) {
+               case NW_DIAG:
+                  w.push_back(x_begin[--i]);
+                  z.push_back(y_begin[--j]);
+                  break;
+               case NW_UP:
+                  w.push_back(x_begin[--i]);
+                  z.push_back(deleted_value);
+                  break;
+               default:
+                  w.push_back(deleted_value);
+                  z.push_back(y_begin[--j]);
+                  break;
+            }
+         }
+      }
+      for(; j > 0; ) {
+         w.push_back(deleted_value);
+         z.push_back(y_begin[--j]);
+      }
+
+      w_back = std::copy(w.rbegin(), w.rend(), w_back);
+      z_back = std::copy(z.rbegin(), z.rend(), z_back);
+   }
+
+   // Needleman-Wunsch in at most budget bytes, the same alignment as NeedlemanWunsch whenever a block of rows fits,
+   // otherwise Hirschberg's. The iterators must be random access.
+
+   template<typename I, typename BI, typename F>
+   void CheckpointNeedlemanWunsch(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function,
+      int_fast64_t budget, typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      typedef typename PP<F, I>::type P;
+
+      int_fast64_t k = checkpoint_rows<P>(std::distance(x_begin, x_end), std::distance(y_begin, y_end), budget);
+      if(k == 0) {
+         Hirschberg(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value);
+      } else {
+         checkpoint_alignment(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value, k);
+      }
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_checkpoint_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_checkpoint_suite(void)
+   {
+      return 0;
+   }
+
+   void checkpoint_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAAATTCACATCTTTACAG";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAATTCACATCTTACAGAACTTTAGC";
+
+      std::vector<std::string> expected(2, std::string());
+      NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected[0]), std::back_inserter(expected[1]),
+         scoring::plus_minus_one);
+
+      // blocks of a single row up to the whole plane, the same alignment every time
+      for(int_fast64_t k : { int_fast64_t(1), int_fast64_t(3), int_fast64_t(40), int_fast64_t(x.size()) }) {
+         std::vector<std::string> result(2, std::string());
+         auto w_back = std::back_inserter(result[0]);
+         auto z_back = std::back_inserter(result[1]);
+         checkpoint_alignment(x.begin(), x.end(), y.begin(), y.end(), w_back, z_back, scoring::plus_minus_one, int16_t(-1), '-', k);
+         CU_ASSERT(result == expected);
+         if(result != expected) {
+            std::cout << std::endl;
+            std::cout << "result[0] = " << result[0] << std::endl;
+            std::cout << "result[1] = " << result[1] << std::endl;
+         }
+      }
+
+      // the largest block which fits
+      int_fast64_t whole = checkpoint_bytes<int16_t>(x.size(), y.size(), x.size());
+      int_fast64_t budget = checkpoint_bytes<int16_t>(x.size(), y.size(), 40);
+      int_fast64_t k = checkpoint_rows<int16_t>(x.size(), y.size(), budget);
+      CU_ASSERT(k >= 40 && k < int_fast64_t(x.size()) && checkpoint_bytes<int16_t>(x.size(), y.size(), k) <= budget);
+      std::vector<std::string> result(2, std::string());
+      CheckpointNeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+         scoring::plus_minus_one, budget);
+      CU_ASSERT(result == expected);
+      CU_ASSERT(checkpoint_rows<int16_t>(x.size(), y.size(), whole) == int_fast64_t(x.size()));
+
+      // too little for any block is Hirschberg
+      CU_ASSERT(checkpoint_rows<int16_t>(x.size(), y.size(), 100) == 0);
+      std::vector<std::string> hirschberg(2, std::string());
+      result.assign(2, std::string());
+      CheckpointNeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+         scoring::plus_minus_one, 100);
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(hirschberg[0]), std::back_inserter(hirschberg[1]),
+         scoring::plus_minus_one);
+      CU_ASSERT(result == hirschberg);
+
+      // empty x
+      std::string empty;
+      result.assign(2, std::string());
+      CheckpointNeedlemanWunsch(empty.begin(), empty.end(), y.begin(), y.begin() + 3, std::back_inserter(result[0]),
+         std::back_inserter(result[1]), scoring::plus_minus_one, 1000);
+      CU_ASSERT(result[0] == "---" && result[1] == "ATT");
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // CHECKPOINT_HPP
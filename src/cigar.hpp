@@ -0,0 +1,388 @@
+#ifndef CIGAR_HPP
+#define CIGAR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+
+namespace stringAlgorithms {
+
+   // CIGAR edit scripts
+   //
+   // An alignment as runs of operations rather than two padded sequences: = equal elements, X a substitution, D an
+   // element of x deleted and I an element of y inserted. Each run is packed into 32 bits the way BAM does it, the
+   // length above 4 bits of the BAM operation code, so an alignment of near duplicates costs a few bytes however long
+   // the inputs are and there is no need for a deleted value that can't occur in the input. The scripts are built
+   // straight from the traceback, cigar_expand() gives the padded form back and cigar_apply() rebuilds y from x and the
+   // elements of y the script doesn't take from x. The engines only write =, X, I and D. M is SAM's match or mismatch,
+   // it is only read by parse_cigar() and cigar_resolve() turns it into = and X given x and y.
+
+   enum cigar_code { CIGAR_MATCH = 0, CIGAR_INSERT = 1, CIGAR_DELETE = 2, CIGAR_EQUAL = 7, CIGAR_MISMATCH = 8 };
+
+   const uint32_t cigar_max_length = (uint32_t(1) << 28) - 1;
+
+   struct cigar_op {
+      uint32_t packed;
+
+      cigar_code code() const { return static_cast<cigar_code>(packed & 15); }
+      uint32_t length() const { return packed >> 4; }
+
+      char letter() const {
+         switch(code()) {
+            case CIGAR_MATCH: return 'M';
+            case CIGAR_EQUAL: return '=';
+            case CIGAR_INSERT: return 'I';
+            case CIGAR_DELETE: return 'D';
+            default: return 'X';
+         }
+      }
+
+      bool operator==(const cigar_op &other) const { return packed == other.packed; }
+      bool operator!=(const cigar_op &other) const { return packed != other.packed; }
+   };
+
+   typedef std::vector<cigar_op> cigar;
+
+   // Append a run of length, joined to the last run if it has the same code, runs too long for 28 bits are split
+
+   inline void cigar_push(cigar &script, cigar_code code, int_fast64_t length) {
+      if(length <= 0) return;
+      if(!script.empty() && script.back().code() == code) {
+         int_fast64_t room = std::min<int_fast64_t>(length, cigar_max_length - script.back().length());
+         script.back().packed += uint32_t(room) << 4;
+         length -= room;
+      }
+      for(; length > 0; length -= cigar_max_length) {
+         script.push_back(cigar_op { uint32_t(std::min<int_fast64_t>(length, cigar_max_length)) << 4 | code });
+      }
+   }
+
+   // Append one script to another joining the runs where they meet
+
+   inline void cigar_append(cigar &script, const cigar &tail) {
+      for(auto &op : tail) cigar_push(script, op.code(), op.length());
+   }
+
+   // Walk a filled traceback_plane from the last cell appending the script to reversed in reverse order
+
+   template<typename I>
+   void nw_traceback_cigar_reversed(const traceback_plane &moves, I x_begin, I x_end, I y_begin, I y_end, cigar &reversed)
+   {
+      int_fast64_t i = std::distance(x_begin, x_end);
+      int_fast64_t j = std::distance(y_begin, y_end);
+
+      while(i != 0 || j != 0) {
+         switch(moves(i, j)) {
+            case NW_DIAG:
+               i--; j--;
+               cigar_push(reversed, x_begin[i] == y_begin[j] ? CIGAR_EQUAL : CIGAR_MISMATCH, 1);
+               break;
+            case NW_UP:
+               i--;
+               cigar_push(reversed, CIGAR_DELETE, 1);
+               break;
+            default:
+               j--;
+               cigar_push(reversed, CIGAR_INSERT, 1);
+               break;
+         }
+      }
+   }
+
+   // The script of the alignment NeedlemanWunsch gives, the iterators must be random access
+
+   template<typename I, typename F>
+   cigar NeedlemanWunschCigar(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1)
+   {
+      traceback_plane moves;
+      nw_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, moves, ID);
+
+      cigar script;
+      nw_traceback_cigar_reversed(moves, x_begin, x_end, y_begin, y_end, script);
+      std::reverse(script.begin(), script.end());
+      return script;
+   }
+
+   template<typename I, typename F, typename P, typename T>
+   void hirschberg_cigar_step(I x_begin, I x_end, I y_begin, I y_end, cigar &script, F &score_function, P ID,
+      hirschberg_workspace<P, T> &workspace, cigar &leaf)
+   {
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      if(x_size == 0 || y_size == 0) {
+         cigar_push(script, CIGAR_DELETE, x_size);
+         cigar_push(script, CIGAR_INSERT, y_size);
+      } else if(x_size == 1 || y_size == 1 || x_size * y_size <= workspace.cutoff) {
+         nw_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, workspace.moves, ID, workspace.row(0), workspace.row(1),
+            &workspace.profile);
+         leaf.clear();
+         nw_traceback_cigar_reversed(workspace.moves, x_begin, x_end, y_begin, y_end, leaf);
+         for(auto op = leaf.rbegin(); op != leaf.rend(); op++) cigar_push(script, op->code(), op->length());
+      } else {
+         auto x_mid = x_size / 2;
+         auto y_mid = hirschberg_split(x_begin, x_begin + x_mid, x_end, y_begin, y_end, score_function, ID, workspace);
+
+         hirschberg_cigar_step(x_begin, x_begin + x_mid, y_begin, y_begin + y_mid, script, score_function, ID, workspace, leaf);
+         hirschberg_cigar_step(x_begin + x_mid, x_end, y_begin + y_mid, y_end, script, score_function, ID, workspace, leaf);
+      }
+   }
+
+   // The script of the alignment Hirschberg gives with the same workspace, the iterators must be random access
+
+   template<typename I, typename F>
+   cigar HirschbergCigar(I x_begin, I x_end, I y_begin, I y_end, F &&score_function,
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> &workspace,
+      typename PP<F, I>::type ID = -1)
+   {
+      cigar script, leaf;
+      workspace.reserve(std::distance(y_begin, y_end));
+      hirschberg_cigar_step(x_begin, x_end, y_begin, y_end, script, score_function, ID, workspace, leaf);
+      return script;
+   }
+
+   template<typename I, typename F>
+   cigar HirschbergCigar(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1)
+   {
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> workspace;
+      return HirschbergCigar(x_begin, x_end, y_begin, y_end, score_function, workspace, ID);
+   }
+
+   // The script of an alignment in the padded form
+
+   template<typename I>
+   cigar cigar_from_alignment(I w_begin, I w_end, I z_begin, const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      cigar script;
+      for(; w_begin != w_end; w_begin++, z_begin++) {
+         if(*w_begin == deleted_value) cigar_push(script, CIGAR_INSERT, 1);
+         else if(*z_begin == deleted_value) cigar_push(script, CIGAR_DELETE, 1);
+         else cigar_push(script, *w_begin == *z_begin ? CIGAR_EQUAL : CIGAR_MISMATCH, 1);
+      }
+      return script;
+   }
+
+   // The padded form of the alignment of x and y given by script, written to w_back and z_back
+
+   template<typename I, typename BI>
+   void cigar_expand(const cigar &script, I x_begin, I y_begin, BI &&w_back, BI &&z_back,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      for(auto &op : script) {
+         for(uint32_t k = 0; k < op.length(); k++) {
+            switch(op.code()) {
+               case CIGAR_DELETE:
+                  *w_back++ = *x_begin++;
+                  *z_back++ = deleted_value;
+                  break;
+               case CIGAR_INSERT:
+                  *w_back++ = deleted_value;
+                  *z_back++ = *y_begin++;
+                  break;
+               default:
+                  *w_back++ = *x_begin++;
+                  *z_back++ = *y_begin++;
+                  break;
+            }
+         }
+      }
+   }
+
+   // True if the script has no M runs, which can't say which elements of y are taken from x
+
+   inline bool cigar_resolved(const cigar &script) {
+      for(auto &op : script) if(op.code() == CIGAR_MATCH) return false;
+      return true;
+   }
+
+   // The script with each M run split into = and X runs by comparing x and y
+
+   template<typename I>
+   cigar cigar_resolve(const cigar &script, I x_begin, I y_begin)
+   {
+      cigar resolved;
+      for(auto &op : script) {
+         if(op.code() != CIGAR_MATCH) {
+            cigar_push(resolved, op.code(), op.length());
+            if(op.code() != CIGAR_INSERT) x_begin += op.length();
+            if(op.code() != CIGAR_DELETE) y_begin += op.length();
+            continue;
+         }
+         for(uint32_t k = 0; k < op.length(); k++, ++x_begin, ++y_begin)
+            cigar_push(resolved, *x_begin == *y_begin ? CIGAR_EQUAL : CIGAR_MISMATCH, 1);
+      }
+      return resolved;
+   }
+
+   // The elements of y which script doesn't take from x, those of its I and X runs in order
+   // false and nothing written if the script has M runs, cigar_resolve() them first
+
+   template<typename I, typename BI>
+   bool cigar_payload(const cigar &script, I y_begin, BI &&payload_back)
+   {
+      if(!cigar_resolved(script)) return false;
+      for(auto &op : script) {
+         if(op.code() == CIGAR_INSERT || op.code() == CIGAR_MISMATCH) payload_back = std::copy(y_begin, y_begin + op.length(), payload_back);
+         if(op.code() != CIGAR_DELETE) y_begin += op.length();
+      }
+      return true;
+   }
+
+   // Rebuild y from x, the script and the payload cigar_payload() took out of y
+   // false and nothing written if the script has M runs, they don't say which elements are in the payload
+
+   template<typename I, typename PI, typename BI>
+   bool cigar_apply(const cigar &script, I x_begin, PI payload_begin, BI &&y_back)
+   {
+      if(!cigar_resolved(script)) return false;
+      for(auto &op : script) {
+         switch(op.code()) {
+            case CIGAR_EQUAL:
+               y_back = std::copy(x_begin, x_begin + op.length(), y_back);
+               x_begin += op.length();
+               break;
+            case CIGAR_MISMATCH:
+               y_back = std::copy(payload_begin, payload_begin + op.length(), y_back);
+               payload_begin += op.length();
+               x_begin += op.length();
+               break;
+            case CIGAR_INSERT:
+               y_back = std::copy(payload_begin, payload_begin + op.length(), y_back);
+               payload_begin += op.length();
+               break;
+            default:
+               x_begin += op.length();
+               break;
+         }
+      }
+      return true;
+   }
+
+   // The script as text, "3=1X2I" as in SAM
+
+   inline std::string cigar_string(const cigar &script) {
+      std::string text;
+      for(auto &op : script) {
+         text += std::to_string(op.length());
+         text += op.letter();
+      }
+      return text;
+   }
+
+   // Parse the SAM text form of I, D, =, X and M runs into script, false if it isn't one. Runs of 0 are dropped
+   // M stays CIGAR_MATCH, match or mismatch, and must go through cigar_resolve() before cigar_payload() or cigar_apply()
+
+   inline bool parse_cigar(const std::string &text, cigar &script) {
+      script.clear();
+      int_fast64_t length = 0;
+      bool digits = false;
+      for(char c : text) {
+         if(c >= '0' && c <= '9') {
+            length = length * 10 + (c - '0');
+            if(length > int_fast64_t(1) << 40) return false;
+            digits = true;
+            continue;
+         }
+         if(!digits) return false;
+         switch(c) {
+            case 'M': cigar_push(script, CIGAR_MATCH, length); break;
+            case '=': cigar_push(script, CIGAR_EQUAL, length); break;
+            case 'X': cigar_push(script, CIGAR_MISMATCH, length); break;
+            case 'I': cigar_push(script, CIGAR_INSERT, length); break;
+            case 'D': cigar_push(script, CIGAR_DELETE, length); break;
+            default: return false;
+         }
+         length = 0;
+         digits = false;
+      }
+      return !digits;
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_cigar_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_cigar_suite(void)
+   {
+      return 0;
+   }
+
+   void cigar_test(void)
+   {
+      std::string x = "GATTACA";
+      std::string y = "GCATGCU";
+
+      // NeedlemanWunsch gives G-ATTACA against GCA-TGCU
+      cigar script = NeedlemanWunschCigar(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one);
+      CU_ASSERT(cigar_string(script) == "1=1I1=1D1=1X1=1X");
+      if(cigar_string(script) != "1=1I1=1D1=1X1=1X") std::cout << std::endl << cigar_string(script) << std::endl;
+
+      // the same as the padded forms of both engines, on a longer pair and with a cutoff small enough to split
+      x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAAATTCACATCTTTACAG";
+      y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAATTCACATCTTACAGAACTTTAGC";
+      std::vector<std::string> nw(2, std::string()), hirschberg(2, std::string()), expanded(2, std::string());
+      NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(nw[0]), std::back_inserter(nw[1]), scoring::plus_minus_one);
+      hirschberg_workspace<int16_t, char> workspace(64);
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(hirschberg[0]), std::back_inserter(hirschberg[1]),
+         scoring::plus_minus_one, workspace);
+
+      script = NeedlemanWunschCigar(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one);
+      CU_ASSERT(script == cigar_from_alignment(nw[0].begin(), nw[0].end(), nw[1].begin()));
+      cigar_expand(script, x.begin(), y.begin(), std::back_inserter(expanded[0]), std::back_inserter(expanded[1]));
+      CU_ASSERT(expanded == nw);
+
+      script = HirschbergCigar(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one, workspace);
+      CU_ASSERT(script == cigar_from_alignment(hirschberg[0].begin(), hirschberg[0].end(), hirschberg[1].begin()));
+
+      // y back from x, the script and the payload, and the script back from its text
+      std::string payload, rebuilt;
+      CU_ASSERT(cigar_payload(script, y.begin(), std::back_inserter(payload)));
+      CU_ASSERT(cigar_apply(script, x.begin(), payload.begin(), std::back_inserter(rebuilt)));
+      CU_ASSERT(rebuilt == y && payload.size() < y.size() / 4);
+      cigar parsed;
+      CU_ASSERT(parse_cigar(cigar_string(script), parsed) && parsed == script);
+      CU_ASSERT(!parse_cigar("3M2", parsed) && !parse_cigar("M", parsed) && !parse_cigar("4Q", parsed));
+
+      // SAM's M covers mismatches too, so it is refused until it is resolved against x and y
+      std::string sam_x = "GATTACA", sam_y = "GACTACA";
+      payload.clear(), rebuilt.clear();
+      CU_ASSERT(parse_cigar("7M", parsed) && parsed.size() == 1 && parsed[0].code() == CIGAR_MATCH);
+      CU_ASSERT(!cigar_payload(parsed, sam_y.begin(), std::back_inserter(payload)) && payload.empty());
+      CU_ASSERT(!cigar_apply(parsed, sam_x.begin(), payload.begin(), std::back_inserter(rebuilt)) && rebuilt.empty());
+      parsed = cigar_resolve(parsed, sam_x.begin(), sam_y.begin());
+      CU_ASSERT(cigar_string(parsed) == "2=1X4=");
+      CU_ASSERT(cigar_payload(parsed, sam_y.begin(), std::back_inserter(payload)) && payload == "C");
+      CU_ASSERT(cigar_apply(parsed, sam_x.begin(), payload.begin(), std::back_inserter(rebuilt)) && rebuilt == sam_y);
+
+      // runs longer than 28 bits are split, and joined runs stay joined
+      script.clear();
+      cigar_push(script, CIGAR_EQUAL, int_fast64_t(cigar_max_length) + 5);
+      cigar_push(script, CIGAR_EQUAL, 5);
+      CU_ASSERT(script.size() == 2 && script[0].length() == cigar_max_length && script[1].length() == 10);
+
+      // integers need no deleted value
+      std::vector<uint64_t> a = { 1, 2, 3, 4, 5 }, b = { 1, 2, 0, 5 };
+      script = HirschbergCigar(a.begin(), a.end(), b.begin(), b.end(), scoring::plus_minus_one);
+      CU_ASSERT(cigar_string(script) == "2=1D1X1=");
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // CIGAR_HPP
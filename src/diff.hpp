@@ -0,0 +1,238 @@
+#ifndef DIFF_HPP
+#define DIFF_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+namespace stringAlgorithms {
+
+   // Myers' O(ND) difference algorithm in linear space
+   //
+   // For unit cost edits (insertions and deletions, no substitutions) the shortest edit script is found by extending
+   // the furthest reaching path on each diagonal, one more edit at a time, from the top left forwards and from the
+   // bottom right backwards. Where the two meet is a point on a shortest path, so the problem splits there and each
+   // half has about half the edits. The time is O((N + M) D) and the space is O(N + M), inputs which differ by a few
+   // edits are diffed in close to linear time however long they are.
+   //
+   // E. Myers, "An O(ND) Difference Algorithm and Its Variations", Algorithmica 1 (1986) 251-266
+
+   // The furthest reaching rows of the forward and backward paths, reused for every split
+
+   struct myers_workspace {
+      std::vector<int_fast64_t> forward, backward;
+   };
+
+   // Where a shortest path from (0, 0) to (x_size, y_size) crosses both halves of the edits, (x_size, y_size) if x and y
+   // share nothing; x and y must differ in their first and last elements
+
+   template<typename I>
+   std::pair<int_fast64_t, int_fast64_t>
+   myers_middle(I x_begin, int_fast64_t x_size, I y_begin, int_fast64_t y_size, myers_workspace &workspace)
+   {
+      int_fast64_t max_d = (x_size + y_size + 1) / 2;
+      int_fast64_t offset = max_d, size = 2 * max_d + 2;
+      int_fast64_t delta = x_size - y_size;
+      bool front = delta % 2 != 0;
+
+      // only the diagonals reached so far are cleared, a split with few edits touches little of the rows
+      std::vector<int_fast64_t> &forward = workspace.forward, &backward = workspace.backward;
+      if((int_fast64_t)forward.size() < size) forward.resize(size), backward.resize(size);
+      forward[offset - 1] = backward[offset - 1] = -1;
+      forward[offset] = backward[offset] = -1;
+      forward[offset + 1] = backward[offset + 1] = 0;
+
+      // diagonals which have run off the edge are not extended again
+      int_fast64_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+
+      for(int_fast64_t d = 0; d < max_d; d++) {
+         if(d > 0) {
+            forward[offset - d - 1] = backward[offset - d - 1] = -1;
+            forward[offset + d + 1] = backward[offset + d + 1] = -1;
+         }
+         for(int_fast64_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+            int_fast64_t k1_offset = offset + k1;
+            int_fast64_t x1;
+            if(k1 == -d || (k1 != d && forward[k1_offset - 1] < forward[k1_offset + 1])) {
+               x1 = forward[k1_offset + 1];
+            } else {
+               x1 = forward[k1_offset - 1] + 1;
+            }
+            int_fast64_t y1 = x1 - k1;
+            while(x1 < x_size && y1 < y_size && x_begin[x1] == y_begin[y1]) x1++, y1++;
+            forward[k1_offset] = x1;
+
+            if(x1 > x_size) {
+               k1_end += 2;
+            } else if(y1 > y_size) {
+               k1_start += 2;
+            } else if(front) {
+               int_fast64_t k2_offset = offset + delta - k1;
+               if(k2_offset >= offset - d - 1 && k2_offset <= offset + d + 1 && backward[k2_offset] != -1) {
+                  if(x1 >= x_size - backward[k2_offset]) return std::make_pair(x1, y1);
+               }
+            }
+         }
+
+         for(int_fast64_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+            int_fast64_t k2_offset = offset + k2;
+            int_fast64_t x2;
+            if(k2 == -d || (k2 != d && backward[k2_offset - 1] < backward[k2_offset + 1])) {
+               x2 = backward[k2_offset + 1];
+            } else {
+               x2 = backward[k2_offset - 1] + 1;
+            }
+            int_fast64_t y2 = x2 - k2;
+            while(x2 < x_size && y2 < y_size && x_begin[x_size - x2 - 1] == y_begin[y_size - y2 - 1]) x2++, y2++;
+            backward[k2_offset] = x2;
+
+            if(x2 > x_size) {
+               k2_end += 2;
+            } else if(y2 > y_size) {
+               k2_start += 2;
+            } else if(!front) {
+               int_fast64_t k1_offset = offset + delta - k2;
+               if(k1_offset >= offset - d - 1 && k1_offset <= offset + d + 1 && forward[k1_offset] != -1) {
+                  int_fast64_t x1 = forward[k1_offset];
+                  int_fast64_t y1 = offset + x1 - k1_offset;
+                  if(x1 >= x_size - x2) return std::make_pair(x1, y1);
+               }
+            }
+         }
+      }
+      return std::make_pair(x_size, y_size);
+   }
+
+   // Write the shortest edit script of x and y as two padded sequences, returns the number of edits
+
+   template<typename I, typename BI>
+   int_fast64_t myers_step(I x_begin, I x_end, I y_begin, I y_end, BI &w_back, BI &z_back,
+      const typename std::iterator_traits<I>::value_type deleted_value, myers_workspace &workspace)
+   {
+      // the common prefix
+      while(x_begin != x_end && y_begin != y_end && *x_begin == *y_begin) {
+         *w_back++ = *x_begin++;
+         *z_back++ = *y_begin++;
+      }
+
+      // the common suffix is written after the middle
+      I x_suffix = x_end, y_suffix = y_end;
+      while(x_suffix != x_begin && y_suffix != y_begin && *(x_suffix - 1) == *(y_suffix - 1)) x_suffix--, y_suffix--;
+
+      int_fast64_t x_size = x_suffix - x_begin;
+      int_fast64_t y_size = y_suffix - y_begin;
+      int_fast64_t edits;
+
+      if(x_size == 0 || y_size == 0) {
+         for(I x_cur = x_begin; x_cur != x_suffix; x_cur++) {
+            *w_back++ = *x_cur;
+            *z_back++ = deleted_value;
+         }
+         for(I y_cur = y_begin; y_cur != y_suffix; y_cur++) {
+            *w_back++ = deleted_value;
+            *z_back++ = *y_cur;
+         }
+         edits = x_size + y_size;
+      } else {
+         auto middle = myers_middle(x_begin, x_size, y_begin, y_size, workspace);
+         if(middle.first == x_size && middle.second == y_size) {
+            // nothing in common, delete x and insert y
+            edits = myers_step(x_begin, x_suffix, y_suffix, y_suffix, w_back, z_back, deleted_value, workspace)
+               + myers_step(x_suffix, x_suffix, y_begin, y_suffix, w_back, z_back, deleted_value, workspace);
+         } else {
+            edits = myers_step(x_begin, x_begin + middle.first, y_begin, y_begin + middle.second, w_back, z_back, deleted_value, workspace)
+               + myers_step(x_begin + middle.first, x_suffix, y_begin + middle.second, y_suffix, w_back, z_back, deleted_value, workspace);
+         }
+      }
+
+      for(; x_suffix != x_end; x_suffix++, y_suffix++) {
+         *w_back++ = *x_suffix;
+         *z_back++ = *y_suffix;
+      }
+      return edits;
+   }
+
+   // The shortest unit cost edit script of x and y, written to w_back and z_back in the padded form NeedlemanWunsch()
+   // writes: equal elements side by side, deletions from x against deleted_value in z and insertions from y against
+   // deleted_value in w. Returns the number of edits, the iterators must be random access and the elements comparable
+   // with ==
+
+   template<typename I, typename BI>
+   int_fast64_t MyersDiff(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      myers_workspace workspace;
+      return myers_step(x_begin, x_end, y_begin, y_end, w_back, z_back, deleted_value, workspace);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_diff_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_diff_suite(void)
+   {
+      return 0;
+   }
+
+   void diff_test(void)
+   {
+      // the example from the paper, D = 5
+      std::string x = "ABCABBA";
+      std::string y = "CBABAC";
+
+      std::vector<std::string> result(2, std::string());
+      int_fast64_t edits = MyersDiff(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]));
+
+      // a valid script of the given length, the padding removed gives x and y back
+      std::string w, z;
+      int_fast64_t gaps = 0;
+      bool aligned = result[0].size() == result[1].size();
+      for(size_t i = 0; aligned && i < result[0].size(); i++) {
+         if(result[0][i] != '-') w.push_back(result[0][i]);
+         if(result[1][i] != '-') z.push_back(result[1][i]);
+         if(result[0][i] == '-' || result[1][i] == '-') gaps++;
+         else aligned = result[0][i] == result[1][i];
+      }
+      CU_ASSERT(edits == 5 && gaps == 5 && aligned && w == x && z == y);
+      if(edits != 5 || !aligned) {
+         std::cout << std::endl;
+         std::cout << "result[0] = " << result[0] << std::endl;
+         std::cout << "result[1] = " << result[1] << std::endl;
+      }
+
+      // one side empty and nothing in common
+      std::vector<int> a = { 1, 2, 3 }, b, c = { 4, 5 };
+      std::vector<int> s, t;
+      CU_ASSERT(MyersDiff(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(s), std::back_inserter(t), 0) == 3);
+      CU_ASSERT(s == a && t == std::vector<int>(3, 0));
+      s.clear(), t.clear();
+      CU_ASSERT(MyersDiff(a.begin(), a.end(), c.begin(), c.end(), std::back_inserter(s), std::back_inserter(t), 0) == 5);
+      CU_ASSERT((s == std::vector<int>{ 1, 2, 3, 0, 0 } && t == std::vector<int>{ 0, 0, 0, 4, 5 }));
+
+      // a few edits in a long sequence
+      std::vector<int> u(10000), v;
+      for(size_t i = 0; i < u.size(); i++) u[i] = i;
+      v = u;
+      v.erase(v.begin() + 5000);
+      v.insert(v.begin() + 100, -1);
+      v[9000] = -2;
+      s.clear(), t.clear();
+      CU_ASSERT(MyersDiff(u.begin(), u.end(), v.begin(), v.end(), std::back_inserter(s), std::back_inserter(t), -3) == 4);
+      CU_ASSERT(s.size() == 10002 && t.size() == 10002);
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // DIFF_HPP
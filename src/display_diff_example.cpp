@@ -1,12 +1,16 @@
 #include <config.h>
 
+#include <iostream>
 #include <string>
 #include <vector>
 
+#include "cigar.hpp"
 #include "needlemanwunsch.hpp"
 #include "stringoutput.hpp"
 
 using stringAlgorithms::NeedlemanWunsch;
+using stringAlgorithms::NeedlemanWunschCigar;
+using stringAlgorithms::cigar_string;
 using stringAlgorithms::display_diff;
 using stringAlgorithms::scoring::plus_minus_one;
 
@@ -23,5 +27,8 @@ int main(int argc, char *argv[])
    NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(s), std::back_inserter(t), plus_minus_one, -1, delIndicator);
    display_diff(s, t, delIndicator);
 
+   // the same alignment as an edit script, which needs no delIndicator
+   std::cout << cigar_string(NeedlemanWunschCigar(x.begin(), x.end(), y.begin(), y.end(), plus_minus_one)) << std::endl;
+
    return 0;
 }
\ No newline at end of file
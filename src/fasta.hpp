@@ -0,0 +1,346 @@
+#ifndef FASTA_HPP
+#define FASTA_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include <cstdio>
+#include <cstdlib>
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#include "hirschberg.hpp"
+#endif
+
+namespace stringAlgorithms {
+
+   // FASTA and plain text input
+   //
+   // A file is mapped into memory rather than read into a std::string, so a reference of gigabytes costs no copy and
+   // only the pages the alignment touches are read. A FASTA sequence is spread over lines which are all the same
+   // width but the last, so position i of a sequence is at line i / width, column i % width and fasta_iterator is a
+   // random access iterator over the bytes of the file that steps over the line ends. The engines take it like any
+   // other iterator. A record whose lines aren't all the same width is copied into a string of its own, the iterator
+   // then walks the copy as a single line. Without mmap() the file is read into memory once.
+
+   // A file mapped read only, or read into memory where mmap() isn't available
+
+   class mapped_file {
+   public:
+      mapped_file() : data_(nullptr), size_(0), mapped_(false) {}
+      ~mapped_file() { close(); }
+
+      mapped_file(const mapped_file &) = delete;
+      mapped_file &operator=(const mapped_file &) = delete;
+
+      // false with error() set if the file can't be opened or mapped
+      bool open(const std::string &path) {
+         close();
+         int fd = ::open(path.c_str(), O_RDONLY);
+         if(fd < 0) return fail(path);
+
+         struct stat st;
+         if(fstat(fd, &st) != 0) {
+            ::close(fd);
+            return fail(path);
+         }
+         size_ = st.st_size;
+
+#ifdef HAVE_MMAP
+         if(size_ > 0) {
+            void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED) {
+               ::close(fd);
+               data_ = static_cast<const char *>(p);
+               mapped_ = true;
+               // no MADV_SEQUENTIAL, Hirschberg reads x forwards and backwards at every split and a query against a
+               // database reads each record once per query, both want the pages kept
+               return true;
+            }
+         }
+#endif
+         // pipes and the like have no size, so read until the end
+         copy_.clear();
+         char buffer[1 << 16];
+         for(ssize_t k; (k = ::read(fd, buffer, sizeof(buffer))) != 0; ) {
+            if(k < 0) {
+               if(errno == EINTR) continue;
+               ::close(fd);
+               return fail(path);
+            }
+            copy_.insert(copy_.end(), buffer, buffer + k);
+         }
+         ::close(fd);
+         data_ = copy_.data();
+         size_ = copy_.size();
+         return true;
+      }
+
+      void close() {
+#ifdef HAVE_MMAP
+         if(mapped_) munmap(const_cast<char *>(data_), size_);
+#endif
+         mapped_ = false;
+         data_ = nullptr;
+         size_ = 0;
+         std::vector<char>().swap(copy_);
+      }
+
+      const char *data() const { return data_; }
+      size_t size() const { return size_; }
+      const std::string &error() const { return error_; }
+
+   private:
+      bool fail(const std::string &path) {
+         error_ = path + ": " + std::strerror(errno);
+         return false;
+      }
+
+      const char           *data_;
+      size_t               size_;
+      bool                 mapped_;
+      std::vector<char>    copy_;
+      std::string          error_;
+   };
+
+   // Random access over a sequence laid out in lines of width bases, each followed by stride - width bytes of line end
+
+   class fasta_iterator {
+   public:
+      typedef std::random_access_iterator_tag   iterator_category;
+      typedef char                              value_type;
+      typedef std::ptrdiff_t                    difference_type;
+      typedef const char                        *pointer;
+      typedef const char                        &reference;
+
+      fasta_iterator() : base_(nullptr), p_(nullptr), i_(0), column_(0), width_(1), skip_(0) {}
+
+      fasta_iterator(const char *base, int_fast64_t i, int_fast64_t width, int_fast64_t stride) :
+         base_(base), i_(i), width_(width), skip_(stride - width) { seek(); }
+
+      reference operator*() const { return *p_; }
+      pointer operator->() const { return p_; }
+      reference operator[](difference_type n) const { return *(*this + n); }
+
+      fasta_iterator &operator++() {
+         ++i_, ++p_;
+         if(++column_ == width_) column_ = 0, p_ += skip_;
+         return *this;
+      }
+
+      fasta_iterator &operator--() {
+         if(column_ == 0) column_ = width_, p_ -= skip_;
+         --i_, --p_, --column_;
+         return *this;
+      }
+
+      fasta_iterator operator++(int) { fasta_iterator t = *this; ++*this; return t; }
+      fasta_iterator operator--(int) { fasta_iterator t = *this; --*this; return t; }
+
+      fasta_iterator &operator+=(difference_type n) { i_ += n; seek(); return *this; }
+      fasta_iterator &operator-=(difference_type n) { i_ -= n; seek(); return *this; }
+
+      fasta_iterator operator+(difference_type n) const { fasta_iterator t = *this; return t += n; }
+      fasta_iterator operator-(difference_type n) const { fasta_iterator t = *this; return t -= n; }
+      friend fasta_iterator operator+(difference_type n, const fasta_iterator &it) { return it + n; }
+      difference_type operator-(const fasta_iterator &other) const { return i_ - other.i_; }
+
+      bool operator==(const fasta_iterator &other) const { return i_ == other.i_; }
+      bool operator!=(const fasta_iterator &other) const { return i_ != other.i_; }
+      bool operator<(const fasta_iterator &other) const { return i_ < other.i_; }
+      bool operator>(const fasta_iterator &other) const { return i_ > other.i_; }
+      bool operator<=(const fasta_iterator &other) const { return i_ <= other.i_; }
+      bool operator>=(const fasta_iterator &other) const { return i_ >= other.i_; }
+
+   private:
+      void seek() {
+         column_ = i_ % width_;
+         p_ = base_ + (i_ / width_) * (width_ + skip_) + column_;
+      }
+
+      const char     *base_, *p_;
+      int_fast64_t   i_, column_, width_, skip_;
+   };
+
+   // One sequence of a FASTA file, its name and its bases in the mapped file or in copy if its lines are uneven
+
+   struct fasta_record {
+      std::string    name;
+      const char     *bases;
+      int_fast64_t   size, width, stride;
+      std::string    copy;
+
+      fasta_iterator begin() const { return fasta_iterator(copy.empty() ? bases : copy.data(), 0, width, stride); }
+      fasta_iterator end() const { return fasta_iterator(copy.empty() ? bases : copy.data(), size, width, stride); }
+   };
+
+   // The records of a FASTA file, or of plain text as a single record named name (the line ends of plain text are
+   // part of the sequence, only a last line end is dropped)
+
+   inline void parse_fasta(const char *data, size_t size, std::vector<fasta_record> &records, bool plain = false,
+      const std::string &name = "")
+   {
+      records.clear();
+      const char *end = data + size;
+
+      if(plain) {
+         if(size > 0 && end[-1] == '\n') end--;
+         if(end > data && end[-1] == '\r') end--;
+         int_fast64_t n = end - data;
+         records.push_back(fasta_record { name, data, n, std::max<int_fast64_t>(1, n), std::max<int_fast64_t>(1, n), std::string() });
+         return;
+      }
+
+      const char *p = data;
+      while(p < end && *p != '>') {
+         const char *line_end = static_cast<const char *>(std::memchr(p, '\n', end - p));
+         p = line_end ? line_end + 1 : end;
+      }
+
+      while(p < end) {
+         // the header, the name is up to the first space
+         const char *line_end = static_cast<const char *>(std::memchr(p, '\n', end - p));
+         if(!line_end) line_end = end;
+         const char *name_end = p + 1;
+         while(name_end < line_end && *name_end != ' ' && *name_end != '\t' && *name_end != '\r') name_end++;
+
+         fasta_record record { std::string(p + 1, name_end), line_end + (line_end < end), 0, 0, 0, std::string() };
+
+         // the lines of bases, all the same width but the last for the record to be read in place
+         bool even = true, blank = false;
+         int_fast64_t previous = 0, previous_stride = 0;
+         for(p = record.bases; p < end && *p != '>'; ) {
+            const char *next = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            const char *text_end = next ? next : end;
+            int_fast64_t ending = next ? 1 : 0;
+            if(text_end > p && text_end[-1] == '\r') text_end--, ending++;
+            int_fast64_t line = text_end - p;
+
+            if(line == 0) {
+               blank = true;
+            } else {
+               if(record.width == 0) {
+                  record.width = line;
+                  record.stride = line + ending;
+                  even = !blank;
+               } else if(blank || previous != record.width || previous_stride != record.stride || line > record.width) {
+                  even = false;
+               }
+               previous = line;
+               previous_stride = line + ending;
+            }
+            record.size += line;
+            p = next ? next + 1 : end;
+         }
+
+         if(!even) {
+            record.copy.reserve(record.size);
+            for(const char *q = record.bases; q < p; q++) {
+               if(*q != '\n' && *q != '\r') record.copy.push_back(*q);
+            }
+         }
+         if(!even || record.width == 0) {
+            record.width = record.stride = std::max<int_fast64_t>(1, record.size);
+            if(record.copy.empty()) record.copy.push_back('\0');
+         }
+         records.push_back(std::move(record));
+      }
+   }
+
+   inline void parse_fasta(const mapped_file &file, std::vector<fasta_record> &records, bool plain = false, const std::string &name = "") {
+      parse_fasta(file.data(), file.size(), records, plain, name);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_fasta_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_fasta_suite(void)
+   {
+      return 0;
+   }
+
+   void fasta_test(void)
+   {
+      std::string text =
+         ">one first record\n"
+         "ACGTA\n"
+         "CGTAC\n"
+         "GT\n"
+         ">two\r\n"
+         "AAC\r\n"
+         "CA\r\n"
+         ">uneven\n"
+         "AC\n"
+         "GTAC\n"
+         "G\n";
+
+      std::vector<fasta_record> records;
+      parse_fasta(text.data(), text.size(), records);
+      CU_ASSERT(records.size() == 3);
+      if(records.size() != 3) return;
+
+      CU_ASSERT(records[0].name == "one" && records[0].copy.empty());
+      CU_ASSERT(std::string(records[0].begin(), records[0].end()) == "ACGTACGTACGT");
+      CU_ASSERT(records[1].name == "two" && records[1].copy.empty());
+      CU_ASSERT(std::string(records[1].begin(), records[1].end()) == "AACCA");
+      CU_ASSERT(records[2].name == "uneven" && !records[2].copy.empty());
+      CU_ASSERT(std::string(records[2].begin(), records[2].end()) == "ACGTACG");
+
+      // random access lands on the same bases as walking, backwards too
+      auto begin = records[0].begin(), end = records[0].end();
+      CU_ASSERT(end - begin == 12 && begin[5] == 'C' && *(end - 1) == 'T' && *(begin + 9) == 'C');
+      std::string backwards { std::reverse_iterator<fasta_iterator>(end), std::reverse_iterator<fasta_iterator>(begin) };
+      CU_ASSERT(backwards == "TGCATGCATGCA");
+
+      // the engines take it, the same alignment as from a string
+      std::string x(records[0].begin(), records[0].end()), y(records[2].begin(), records[2].end());
+      std::vector<std::string> expected(2, std::string()), result(2, std::string());
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected[0]), std::back_inserter(expected[1]),
+         scoring::plus_minus_one);
+      Hirschberg(records[0].begin(), records[0].end(), records[2].begin(), records[2].end(), std::back_inserter(result[0]),
+         std::back_inserter(result[1]), scoring::plus_minus_one);
+      CU_ASSERT(result == expected);
+
+      // plain text is one record, mapped from a file
+      char path[] = "/tmp/fasta_testXXXXXX";
+      int fd = mkstemp(path);
+      CU_ASSERT(fd >= 0);
+      if(fd < 0) return;
+      std::string plain = "GATTACA\nGATTACA\n";
+      CU_ASSERT(write(fd, plain.data(), plain.size()) == ssize_t(plain.size()));
+      ::close(fd);
+
+      mapped_file file;
+      CU_ASSERT(file.open(path) && file.size() == plain.size());
+      parse_fasta(file, records, true, "plain");
+      CU_ASSERT(records.size() == 1 && records[0].name == "plain");
+      CU_ASSERT(std::string(records[0].begin(), records[0].end()) == "GATTACA\nGATTACA");
+      file.close();
+      unlink(path);
+
+      CU_ASSERT(!file.open("/nonexistent/fasta") && !file.error().empty());
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // FASTA_HPP
@@ -0,0 +1,236 @@
+#include <config.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "align.hpp"
+#include "cigar.hpp"
+#include "fasta.hpp"
+#include "render.hpp"
+#include "taskpool.hpp"
+
+using stringAlgorithms::ALIGN_BANDED;
+using stringAlgorithms::ALIGN_CHECKPOINT;
+using stringAlgorithms::ALIGN_HIRSCHBERG;
+using stringAlgorithms::ALIGN_NEEDLEMAN_WUNSCH;
+using stringAlgorithms::ALIGN_PARALLEL_HIRSCHBERG;
+using stringAlgorithms::BandedHirschberg;
+using stringAlgorithms::CheckpointNeedlemanWunsch;
+using stringAlgorithms::HirschbergCigar;
+using stringAlgorithms::NeedlemanWunschCigar;
+using stringAlgorithms::ParallelHirschberg;
+using stringAlgorithms::align;
+using stringAlgorithms::cigar;
+using stringAlgorithms::cigar_from_alignment;
+using stringAlgorithms::cigar_string;
+using stringAlgorithms::diff_writer;
+using stringAlgorithms::fasta_record;
+using stringAlgorithms::mapped_file;
+using stringAlgorithms::parse_fasta;
+using stringAlgorithms::task_group;
+using stringAlgorithms::task_pool;
+
+// aligns the records of FASTA or plain text files read straight from the mapped files
+//
+//    fasta_align [-e engine] [-t threads] [-m budget] [-M match] [-X mismatch] [-G gap] [-q] [-r] x [y]
+//
+// with one file its records are aligned in pairs, the first with the second, the third with the fourth and so on,
+// with two files record i of x is aligned with record i of y, and with -q every record of x with every record of y.
+// -r takes each file as a single sequence of plain text. The engine is nw, hirschberg, banded, checkpoint, parallel
+// or auto, auto lets align() choose from the budget in bytes. Each alignment is a line of
+//
+//    name_x  name_y  length_x  length_y  score  cigar
+//
+// separated by tabs. Several pairs are spread over the threads, a single pair gets all of them.
+
+enum { ENGINE_AUTO = -1 };
+
+struct pair_result {
+   int_fast64_t   score;
+   cigar          script;
+};
+
+template<typename F>
+pair_result align_pair(const fasta_record &x, const fasta_record &y, F &score_function, int32_t gap, int32_t match,
+   int32_t mismatch, int engine, int_fast64_t budget, unsigned threads)
+{
+   pair_result result;
+   if(engine == ALIGN_NEEDLEMAN_WUNSCH) {
+      result.script = NeedlemanWunschCigar(x.begin(), x.end(), y.begin(), y.end(), score_function, gap);
+   } else if(engine == ALIGN_HIRSCHBERG) {
+      result.script = HirschbergCigar(x.begin(), x.end(), y.begin(), y.end(), score_function, gap);
+   } else {
+      // the other engines write padded columns, '\0' marks the gaps since it is never a base
+      std::string w, z;
+      if(engine == ALIGN_BANDED)
+         BandedHirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z), score_function, gap, '\0');
+      else if(engine == ALIGN_CHECKPOINT)
+         CheckpointNeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z), score_function,
+            budget, gap, '\0');
+      else if(engine == ALIGN_PARALLEL_HIRSCHBERG)
+         ParallelHirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z), score_function, gap,
+            '\0', threads);
+      else
+         align(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z), score_function, budget, gap, '\0',
+            -1, threads);
+      result.script = cigar_from_alignment(w.begin(), w.end(), z.begin(), '\0');
+   }
+
+   // the gap penalty is linear so the score follows from the lengths of the operations
+   result.score = 0;
+   for(auto op : result.script) {
+      switch(op.code()) {
+         case stringAlgorithms::CIGAR_EQUAL: result.score += int_fast64_t(op.length()) * match; break;
+         case stringAlgorithms::CIGAR_MISMATCH: result.score += int_fast64_t(op.length()) * mismatch; break;
+         default: result.score += int_fast64_t(op.length()) * gap; break;
+      }
+   }
+   return result;
+}
+
+void write_result(diff_writer &out, const fasta_record &x, const fasta_record &y, const pair_result &result)
+{
+   out.write(x.name), out.put('\t');
+   out.write(y.name), out.put('\t');
+   out.write(x.size), out.put('\t');
+   out.write(y.size), out.put('\t');
+   out.write(result.score), out.put('\t');
+   out.write(cigar_string(result.script)), out.put('\n');
+}
+
+// flush the output, a write that failed on the way (a full disk, a closed socket) is an error
+
+int finish(diff_writer &out, const char *program)
+{
+   if(out.flush()) return 0;
+   fprintf(stderr, "%s: writing the alignments failed: %s\n", program, strerror(out.error()));
+   return 1;
+}
+
+int main(int argc, char *argv[])
+{
+   int            engine = ALIGN_HIRSCHBERG;
+   unsigned       threads = std::max(1u, std::thread::hardware_concurrency());
+   int_fast64_t   budget = int_fast64_t(1) << 30;
+   int32_t        match = 1, mismatch = -1, gap = -1;
+   bool           query = false, plain = false;
+   int            c;
+
+   while((c = getopt(argc, argv, "e:t:m:M:X:G:qr")) != -1) {
+      switch(c) {
+         case 'e':
+            if(strcmp(optarg, "nw") == 0) engine = ALIGN_NEEDLEMAN_WUNSCH;
+            else if(strcmp(optarg, "hirschberg") == 0) engine = ALIGN_HIRSCHBERG;
+            else if(strcmp(optarg, "banded") == 0) engine = ALIGN_BANDED;
+            else if(strcmp(optarg, "checkpoint") == 0) engine = ALIGN_CHECKPOINT;
+            else if(strcmp(optarg, "parallel") == 0) engine = ALIGN_PARALLEL_HIRSCHBERG;
+            else if(strcmp(optarg, "auto") == 0) engine = ENGINE_AUTO;
+            else {
+               fprintf(stderr, "%s: unknown engine %s\n", argv[0], optarg);
+               return 1;
+            }
+            break;
+         case 't':
+            threads = std::max(1, atoi(optarg));
+            break;
+         case 'm':
+            budget = atoll(optarg);
+            break;
+         case 'M':
+            match = atoi(optarg);
+            break;
+         case 'X':
+            mismatch = atoi(optarg);
+            break;
+         case 'G':
+            gap = atoi(optarg);
+            break;
+         case 'q':
+            query = true;
+            break;
+         case 'r':
+            plain = true;
+            break;
+         default:
+            fprintf(stderr, "usage: %s [-e nw|hirschberg|banded|checkpoint|parallel|auto] [-t threads] [-m budget] "
+               "[-M match] [-X mismatch] [-G gap] [-q] [-r] x [y]\n", argv[0]);
+            return 1;
+      }
+   }
+
+   int files = argc - optind;
+   if(files < 1 || files > 2 || (query && files != 2)) {
+      fprintf(stderr, "%s: %s\n", argv[0], query ? "-q needs a query and a database file" : "one or two files to align");
+      return 1;
+   }
+
+   mapped_file x_file, y_file;
+   std::vector<fasta_record> x_records, y_records;
+   if(!x_file.open(argv[optind])) {
+      fprintf(stderr, "%s: %s\n", argv[0], x_file.error().c_str());
+      return 1;
+   }
+   parse_fasta(x_file, x_records, plain, argv[optind]);
+   if(files == 2) {
+      if(!y_file.open(argv[optind + 1])) {
+         fprintf(stderr, "%s: %s\n", argv[0], y_file.error().c_str());
+         return 1;
+      }
+      parse_fasta(y_file, y_records, plain, argv[optind + 1]);
+   }
+
+   // the pairs as indices into the records, with one file both sides are taken from it
+   const std::vector<fasta_record> &left = x_records, &right = files == 2 ? y_records : x_records;
+   std::vector<std::pair<size_t, size_t>> pairs;
+   if(query) {
+      for(size_t i = 0; i < left.size(); i++)
+         for(size_t j = 0; j < right.size(); j++) pairs.push_back(std::make_pair(i, j));
+   } else if(files == 2) {
+      if(left.size() != right.size())
+         fprintf(stderr, "%s: %zu and %zu records, only the first %zu pairs are aligned\n", argv[0], left.size(), right.size(),
+            std::min(left.size(), right.size()));
+      for(size_t i = 0; i < std::min(left.size(), right.size()); i++) pairs.push_back(std::make_pair(i, i));
+   } else {
+      if(left.size() % 2 != 0) fprintf(stderr, "%s: an odd number of records, the last is not aligned\n", argv[0]);
+      for(size_t i = 0; i + 1 < left.size(); i += 2) pairs.push_back(std::make_pair(i, i + 1));
+   }
+
+   auto score_function = [match, mismatch](const char &a, const char &b) -> int32_t { return a == b ? match : mismatch; };
+   diff_writer out(1, false);
+
+   if(pairs.size() == 1 || threads == 1) {
+      for(auto &p : pairs) {
+         pair_result result = align_pair(left[p.first], right[p.second], score_function, gap, match, mismatch, engine, budget, threads);
+         write_result(out, left[p.first], right[p.second], result);
+      }
+      return finish(out, argv[0]);
+   }
+
+   // a block of pairs at a time over the pool, written in order once the block is done
+   task_pool pool(threads);
+   std::vector<pair_result> results;
+   size_t block = 64 * threads;
+   for(size_t begin = 0; begin < pairs.size(); begin += block) {
+      size_t end = std::min(pairs.size(), begin + block);
+      results.assign(end - begin, pair_result());
+      {
+         task_group group(pool);
+         for(size_t k = begin; k < end; k++) {
+            group.run([&, k] {
+               results[k - begin] = align_pair(left[pairs[k].first], right[pairs[k].second], score_function, gap, match, mismatch, engine,
+                  budget, 1);
+            });
+         }
+         group.wait();
+      }
+      for(size_t k = begin; k < end; k++) write_result(out, left[pairs[k].first], right[pairs[k].second], results[k - begin]);
+   }
+
+   return finish(out, argv[0]);
+}
@@ -15,95 +15,174 @@
 
 #include "stringUtility.hpp"
 #include "needlemanwunsch.hpp"
+#include "nwrow.hpp"
 
 namespace stringAlgorithms {
 
+   // The last row of the Needleman-Wunsch score matrix computed in the caller's rows
+   // top and bottom hold y_size + 1 scores, the row is left in whichever is returned
+   // the rows are computed by nw_row_sweep which uses SIMD when the score function can be made into a table
+
+   template<typename I, typename F>
+   typename PP<F, I>::type *
+   nw_score_row(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID,
+      typename PP<F, I>::type *top, typename PP<F, I>::type *bottom, std::vector<typename PP<F, I>::type> *profile = nullptr,
+      nw_mode mode = NW_GLOBAL)
+   {
+      nw_row_sweep<I, F> sweep(y_begin, y_end, score_function, ID, profile);
+
+      sweep.first_row(top);
+      nw_mode_first_row(top, sweep.size(), mode);
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++) {
+         sweep(*x_cur, top, bottom);
+         nw_mode_row(bottom, sweep.size(), mode);
+         std::swap(top, bottom);
+      }
+      return top;
+   }
+
+   // The last row of the Needleman-Wunsch score matrix computed in linear space
+
    template<typename I, typename F>
    std::vector<typename PP<F, I>::type>
-   nwScore(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1)
+   nwScore(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1, nw_mode mode = NW_GLOBAL)
    {
 
       typedef typename PP<F, I>::type P;
 
-      auto x_size = std::distance(x_begin, x_end);
       auto y_size = std::distance(y_begin, y_end);
 
       std::vector<P>    top(y_size + 1);
       std::vector<P>    bottom(y_size + 1);
 
-      top[0] = 0;
-      for(auto j = 1; j <= y_size; j++) top[j] = top[j-1] + ID;
-
-      auto x_cur = x_begin;
-      for(auto i = 1; i <= x_size; i++) {
-         bottom[0] = top[0] + ID;
-         auto y_cur = y_begin;
-         for(auto j = 1; j <= y_size; j++) {
-            P score_sub = top[j-1] + score_function(*x_cur, *y_cur);
-            P score_del = top[j] + ID;
-            P score_ins = bottom[j-1] + ID;
-            bottom[j] = std::max({score_sub, score_del, score_ins});
-            y_cur++;
-         }
-         x_cur++;
+      if(nw_score_row(x_begin, x_end, y_begin, y_end, score_function, ID, top.data(), bottom.data(), nullptr, mode) != top.data()) {
          std::swap(top, bottom);
       }
       return top;
    }
 
+   // The index which maximizes left[j] + right[n - j], the first one if there is a tie
+
    template<typename I>
    int_fast64_t partition(I left_begin, I left_end, I right_begin, I right_end) {
       typedef typename std::iterator_traits<I>::value_type I_type;
-      std::reverse_iterator<I> reverse_right_begin(right_end);
-      std::reverse_iterator<I> reverse_right_end(right_begin);
 
-      std::vector<I_type> vector_sum(std::distance(left_begin, left_end));
+      std::reverse_iterator<I> right_cur(right_end);
 
-      std::transform(left_begin, left_end, reverse_right_begin, vector_sum.begin(), [](const I_type &a, const I_type &b) -> I_type { return a + b; });
+      I_type         best = *left_begin + *right_cur;
+      int_fast64_t   best_index = 0, index = 0;
 
-      auto max_p = std::max_element(vector_sum.begin(), vector_sum.end());
-      return std::distance(vector_sum.begin(), max_p);
+      for(auto left_cur = left_begin; left_cur != left_end; left_cur++, right_cur++, index++) {
+         I_type sum = *left_cur + *right_cur;
+         if(sum > best) {
+            best = sum;
+            best_index = index;
+         }
+      }
+      return best_index;
    }
 
-   template<typename I, typename BI, typename F>
-   void Hirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, typename PP<F, I>::type ID = -1,
-      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   // The default number of cells at or below which Hirschberg stops splitting and solves a sub-problem with the
+   // full matrix, chosen so that the traceback plane (2 bits per cell) fits in half the L2 cache
+
+   inline int_fast64_t hirschberg_default_cutoff() {
+      return l2_cache_bytes() * 2;
+   }
+
+   // Scratch space for Hirschberg
+   // every level of the recursion reuses the same rows since a split is finished with its scores before either half
+   // starts, reserve() sizes it for the longest y and a workspace can be passed to Hirschberg for any number of calls
+   // cutoff is the number of cells at or below which a sub-problem is solved with the full matrix, 0 splits until
+   // one side has a single element
+
+   template<typename P, typename T>
+   class hirschberg_workspace {
+   public:
+      explicit hirschberg_workspace(int_fast64_t cutoff = hirschberg_default_cutoff()) : cutoff(cutoff) {}
+
+      void reserve(int_fast64_t y_size) {
+         if((int_fast64_t)rows_[0].size() < y_size + 1) {
+            for(auto &r : rows_) r.resize(y_size + 1);
+         }
+      }
+
+      P *row(int k) { return rows_[k].data(); }
+
+      int_fast64_t      cutoff;
+      std::vector<P>    profile;
+      traceback_plane   moves;
+      std::vector<T>    w, z;
+
+   private:
+      std::vector<P>    rows_[4];
+   };
+
+   // Where an optimal path crosses from row x_mid - x_begin into the next, as an offset into y
+   // the second half is run backwards through reverse iterators rather than copies
+
+   template<typename I, typename F, typename P, typename T>
+   int_fast64_t hirschberg_split(I x_begin, I x_mid, I x_end, I y_begin, I y_end, F &score_function, P ID,
+      hirschberg_workspace<P, T> &workspace)
+   {
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      P *ScoreL = nw_score_row(x_begin, x_mid, y_begin, y_end, score_function, ID, workspace.row(0), workspace.row(1), &workspace.profile);
+      P *ScoreR = nw_score_row(std::reverse_iterator<I>(x_end), std::reverse_iterator<I>(x_mid),
+         std::reverse_iterator<I>(y_end), std::reverse_iterator<I>(y_begin), score_function, ID,
+         workspace.row(2), workspace.row(3), &workspace.profile);
+
+      return partition(ScoreL, ScoreL + y_size + 1, ScoreR, ScoreR + y_size + 1);
+   }
+
+   template<typename I, typename BI, typename F, typename P, typename T>
+   void hirschberg_step(I x_begin, I x_end, I y_begin, I y_end, BI &w_back, BI &z_back, F &score_function, P ID, const T deleted_value,
+      hirschberg_workspace<P, T> &workspace)
    {
       int_fast64_t x_size = std::distance(x_begin, x_end);
       int_fast64_t y_size = std::distance(y_begin, y_end);
 
       if(x_size == 0) {
-         std::fill_n(w_back, y_size, deleted_value);
-         std::copy(y_begin, y_end, z_back);
+         w_back = std::fill_n(w_back, y_size, deleted_value);
+         z_back = std::copy(y_begin, y_end, z_back);
       } else if(y_size == 0) {
-         std::copy(x_begin, x_end, w_back);
-         std::fill_n(z_back, x_size, deleted_value);
-      } else if(x_size == 1 || y_size == 1) {
-         NeedlemanWunsch(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value);
+         w_back = std::copy(x_begin, x_end, w_back);
+         z_back = std::fill_n(z_back, x_size, deleted_value);
+      } else if(x_size == 1 || y_size == 1 || x_size * y_size <= workspace.cutoff) {
+         nw_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, workspace.moves, ID, workspace.row(0), workspace.row(1),
+            &workspace.profile);
+         workspace.w.clear();
+         workspace.z.clear();
+         nw_traceback_reversed(workspace.moves, x_begin, x_end, y_begin, y_end, workspace.w, workspace.z, deleted_value);
+         w_back = std::copy(workspace.w.rbegin(), workspace.w.rend(), w_back);
+         z_back = std::copy(workspace.z.rbegin(), workspace.z.rend(), z_back);
       } else {
          auto x_mid = x_size / 2;
+         auto y_mid = hirschberg_split(x_begin, x_begin + x_mid, x_end, y_begin, y_end, score_function, ID, workspace);
 
-         auto ScoreL = nwScore(x_begin, x_begin + x_mid, y_begin, y_end, score_function, ID);
-         
-         std::vector<typename std::iterator_traits<I>::value_type> y_reverse;
-         std::copy(y_begin, y_end, back_inserter(y_reverse));
-         std::reverse(y_reverse.begin(), y_reverse.end());
-
-         std::vector<typename std::iterator_traits<I>::value_type> x_reverse;
-         std::copy(x_begin + x_mid, x_end, back_inserter(x_reverse));
-         std::reverse(x_reverse.begin(), x_reverse.end());
-
-
-         auto ScoreR = nwScore(x_reverse.begin(), x_reverse.end(), y_reverse.begin(), y_reverse.end(), score_function, ID);
-
-         auto y_mid = partition(ScoreL.begin(), ScoreL.end(), ScoreR.begin(), ScoreR.end());
+         hirschberg_step(x_begin, x_begin + x_mid, y_begin, y_begin + y_mid, w_back, z_back, score_function, ID, deleted_value, workspace);
+         hirschberg_step(x_begin + x_mid, x_end, y_begin + y_mid, y_end, w_back, z_back, score_function, ID, deleted_value, workspace);
+      }
+   }
 
-         Hirschberg(x_begin, x_begin + x_mid, y_begin, y_begin + y_mid, w_back, z_back, score_function, ID, deleted_value);
-         Hirschberg(x_begin + x_mid, x_end, y_begin + y_mid, y_end, w_back, z_back, score_function, ID, deleted_value);
+   // Hirschberg using the scratch rows in workspace, once the workspace has grown to the longest y it is given
+   // (and the largest sub-problem at or under its cutoff) this makes no allocations other than those of w_back and z_back
 
-      }
+   template<typename I, typename BI, typename F>
+   void Hirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function,
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> &workspace,
+      typename PP<F, I>::type ID = -1, const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      workspace.reserve(std::distance(y_begin, y_end));
+      hirschberg_step(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value, workspace);
    }
 
+   template<typename I, typename BI, typename F>
+   void Hirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, typename PP<F, I>::type ID = -1,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      hirschberg_workspace<typename PP<F, I>::type, typename std::iterator_traits<I>::value_type> workspace;
+      Hirschberg(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, workspace, ID, deleted_value);
+   }
 
 #ifdef HAVE_CUNIT_CUNIT_H
 
@@ -133,6 +212,27 @@ namespace stringAlgorithms {
       return;
    }
 
+   void hirschberg_nwScore_simd_test(void)
+   {
+      // long enough to cover whole vectors and the scalar tail, compared against the full matrix
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+
+      auto zero_one = [](const char &a, const char &b) -> int16_t { return a == b ? 1 : 0; };
+      auto three_two = [](const char &a, const char &b) -> int16_t { return a == b ? 3 : -2; };
+
+      auto matrix = nw_score_matrix(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one);
+      CU_ASSERT(nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one) == matrix.back());
+
+      matrix = nw_score_matrix(x.begin(), x.end(), y.begin(), y.end(), zero_one, 0);
+      CU_ASSERT(nwScore(x.begin(), x.end(), y.begin(), y.end(), zero_one, 0) == matrix.back());
+
+      matrix = nw_score_matrix(y.rbegin(), y.rend(), x.rbegin(), x.rend(), three_two, -3);
+      CU_ASSERT(nwScore(y.rbegin(), y.rend(), x.rbegin(), x.rend(), three_two, -3) == matrix.back());
+
+      return;
+   }
+
    void hirschberg_test(void)
    {
       std::string x = "GATTACA";
@@ -180,6 +280,68 @@ namespace stringAlgorithms {
 
    }
 
+   void hirschberg_workspace_test(void)
+   {
+      std::string x = "AGTACGCA";
+      std::string y = "TATGC";
+
+      std::vector<std::string> expectedResult = {
+         "AGTACGCA",
+         "--TATGC-",
+         "G-ATTACA",
+         "GCA-TGCU"
+      };
+      std::vector<std::string> result(4, std::string());
+
+      // one workspace for both calls, the second has a longer y so the workspace grows
+      hirschberg_workspace<int16_t, char> workspace;
+
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]), scoring::plus_minus_one, workspace);
+
+      x = "GATTACA";
+      y = "GCATGCU";
+
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[2]), std::back_inserter(result[3]), scoring::plus_minus_one, workspace);
+
+      CU_ASSERT(result == expectedResult);
+      if(result != expectedResult) {
+         std::cout << std::endl;
+         for(auto &r : result) std::cout << r << std::endl;
+      }
+      return;
+   }
+
+   void hirschberg_cutoff_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+
+      // every cutoff has to give an alignment with the optimal score, and one covering the whole problem is NeedlemanWunsch
+      auto score = [](const std::string &w, const std::string &z) {
+         int s = 0;
+         for(size_t i = 0; i < w.size(); i++) s += (w[i] == '-' || z[i] == '-') ? -1 : scoring::plus_minus_one(w[i], z[i]);
+         return s;
+      };
+
+      auto optimal = nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one).back();
+
+      for(int_fast64_t cutoff : { 0, 16, 256, 4096, 1 << 20 }) {
+         std::string w, z;
+         hirschberg_workspace<int16_t, char> workspace(cutoff);
+         Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z), scoring::plus_minus_one, workspace);
+         CU_ASSERT(score(w, z) == optimal);
+         CU_ASSERT(w.size() == z.size());
+      }
+
+      std::string w, z, s, t;
+      hirschberg_workspace<int16_t, char> workspace(1 << 20);
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z), scoring::plus_minus_one, workspace);
+      NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(s), std::back_inserter(t), scoring::plus_minus_one);
+      CU_ASSERT(w == s && z == t);
+
+      return;
+   }
+
 #endif // HAVE_CUNIT_CUNIT_H
 
 } // stringAlgorithms
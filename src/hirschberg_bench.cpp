@@ -6,10 +6,12 @@
 #include <unistd.h>
 
 #include "hirschberg.hpp"
+#include "packed.hpp"
 #include "stringoutput.hpp"
 
 using stringAlgorithms::Hirschberg;
 using stringAlgorithms::display_diff;
+using stringAlgorithms::packed_sequence;
 using stringAlgorithms::scoring::plus_minus_one;
 
 int16_t plus_minus_one_p(const char &x, const char &y) {
@@ -28,11 +30,11 @@ int main(int argc, char *argv[])
    int16_t  count = 1000;
    int      c;
 
-   enum function_type { POINTER, FUNCTOR, LAMBDA, STD_FUNCTION };
+   enum function_type { POINTER, FUNCTOR, LAMBDA, STD_FUNCTION, PACKED };
 
    function_type f_type = LAMBDA;
 
-   while((c = getopt(argc, argv, "pflsn:")) != -1) {
+   while((c = getopt(argc, argv, "pflskn:")) != -1) {
       switch(c) {
          case 'p':
             f_type = POINTER;
@@ -46,6 +48,9 @@ int main(int argc, char *argv[])
          case 's':
             f_type = STD_FUNCTION;
             break;
+         case 'k':
+            f_type = PACKED;
+            break;
          case 'n':
             count = atoi(optarg);
             break;
@@ -126,6 +131,23 @@ int main(int argc, char *argv[])
             s.erase(); t.erase();
          }
          break;   
+      case PACKED: {
+         // the same alignments read from 2 bit packed copies of x, y and z
+         packed_sequence px(x), py(y), pz(z);
+         for(int16_t i=0; i < count; i++) {
+            std::string s, t;
+
+            Hirschberg(px.begin(), px.end(), py.begin(), py.end(), std::back_inserter(s), std::back_inserter(t), plus_minus_one);
+            s.erase(); t.erase();
+
+            Hirschberg(px.begin(), px.end(), pz.begin(), pz.end(), std::back_inserter(s), std::back_inserter(t), plus_minus_one);
+            s.erase(); t.erase();
+
+            Hirschberg(py.begin(), py.end(), pz.begin(), pz.end(), std::back_inserter(s), std::back_inserter(t), plus_minus_one);
+            s.erase(); t.erase();
+         }
+         break;
+      }
    }
 
    return 0;
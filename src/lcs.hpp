@@ -1,7 +1,12 @@
 #ifndef LCS_HPP
 #define LCS_HPP
 
+#include <bitset>
+#include <cstdint>
 #include <iterator>
+#include <map>
+#include <type_traits>
+#include <vector>
 
 #include "hirschberg.hpp"
 
@@ -12,21 +17,214 @@
 
 namespace stringAlgorithms {
 
+   // Bit-parallel LCS (Allison-Dix, Hyyro)
+   //
+   // A row of the LCS table only ever steps up by 0 or 1 so it can be held as one bit per column, a 0 bit where the
+   // row steps up. With M the bits of the columns where y matches x[i] the next row is
+   //
+   //    V' = (V + (V & M)) | (V & ~M)
+   //
+   // which is 64 columns per word operation, the carry of the add is passed from word to word. The LCS length of
+   // x[0, i) and y[0, j) is the number of 0 bits among the first j bits of row i.
+   //
+   // Byte elements look up their bits in a table indexed by the byte, other element types in a std::map so they need
+   // operator<.
+
+   inline int_fast64_t lcs_words(int_fast64_t y_size) {
+      return (y_size + 63) / 64;
+   }
+
+   inline int_fast64_t lcs_popcount(uint64_t x) {
+      return std::bitset<64>(x).count();
+   }
+
+   // The bits of y for each distinct element of y, assign() can be called again to reuse the memory
+
+   template<typename T, bool = sizeof(T) == 1 && std::is_integral<T>::value>
+   class lcs_match_table {
+   public:
+      template<typename I>
+      void assign(I y_begin, I y_end) {
+         words_ = lcs_words(std::distance(y_begin, y_end));
+         index_.clear();
+         bits_.clear();
+         int_fast64_t j = 0;
+         for(auto y_cur = y_begin; y_cur != y_end; y_cur++, j++) {
+            auto found = index_.insert(std::make_pair(*y_cur, int_fast64_t(bits_.size())));
+            if(found.second) bits_.resize(bits_.size() + words_);
+            bits_[found.first->second + j / 64] |= uint64_t(1) << (j % 64);
+         }
+      }
+
+      // the bits of c, nullptr if c isn't in y
+      const uint64_t *find(const T &c) const {
+         auto found = index_.find(c);
+         return found == index_.end() ? nullptr : bits_.data() + found->second;
+      }
+
+   private:
+      int_fast64_t                  words_;
+      std::map<T, int_fast64_t>     index_;
+      std::vector<uint64_t>         bits_;
+   };
+
+   template<typename T>
+   class lcs_match_table<T, true> {
+   public:
+      template<typename I>
+      void assign(I y_begin, I y_end) {
+         words_ = lcs_words(std::distance(y_begin, y_end));
+         std::fill(std::begin(index_), std::end(index_), -1);
+         bits_.clear();
+         int_fast64_t j = 0;
+         for(auto y_cur = y_begin; y_cur != y_end; y_cur++, j++) {
+            auto c = static_cast<unsigned char>(*y_cur);
+            if(index_[c] < 0) {
+               index_[c] = bits_.size();
+               bits_.resize(bits_.size() + words_);
+            }
+            bits_[index_[c] + j / 64] |= uint64_t(1) << (j % 64);
+         }
+      }
+
+      const uint64_t *find(const T &c) const {
+         auto index = index_[static_cast<unsigned char>(c)];
+         return index < 0 ? nullptr : bits_.data() + index;
+      }
+
+   private:
+      int_fast64_t            words_;
+      int_fast64_t            index_[256];
+      std::vector<uint64_t>   bits_;
+   };
+
+   // The last row of the LCS table of x against the y that table was built from, one bit per column of y
+   // rows of x elements which aren't in y are the same as the row above so they are skipped
+   // the table is an lcs_match_table or anything else with the same find()
+
+   template<typename I, typename Table>
+   void lcs_bit_row(I x_begin, I x_end, const Table &table, int_fast64_t y_size, std::vector<uint64_t> &V)
+   {
+      int_fast64_t words = lcs_words(y_size);
+
+      V.assign(words, ~uint64_t(0));
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++) {
+         const uint64_t *M = table.find(*x_cur);
+         if(!M) continue;
+         uint64_t carry = 0;
+         for(int_fast64_t w = 0; w < words; w++) {
+            uint64_t v = V[w], u = v & M[w];
+            uint64_t sum = v + u;
+            uint64_t next_carry = sum < v;
+            sum += carry;
+            next_carry |= sum < carry;
+            V[w] = sum | (v & ~M[w]);
+            carry = next_carry;
+         }
+      }
+   }
+
+   // The number of 0 bits among the first j bits of V, the LCS length of the row against y[0, j)
+
+   inline int_fast64_t lcs_row_length(const std::vector<uint64_t> &V, int_fast64_t j) {
+      int_fast64_t ones = 0;
+      for(int_fast64_t w = 0; w < j / 64; w++) ones += lcs_popcount(V[w]);
+      if(j % 64) ones += lcs_popcount(V[j / 64] & ((uint64_t(1) << (j % 64)) - 1));
+      return j - ones;
+   }
+
+   // Scratch space for longest_common_subsequence, it can be reused for any number of calls
+
+   template<typename T>
+   struct lcs_workspace {
+      lcs_match_table<T>      table;
+      std::vector<uint64_t>   left, right;
+   };
+
+   template<typename I, typename BI, typename T>
+   void lcs_step(I x_begin, I x_end, I y_begin, I y_end, BI &z_back, lcs_workspace<T> &workspace)
+   {
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      if(x_size == 0 || y_size == 0) return;
+
+      if(x_size == 1) {
+         for(auto y_cur = y_begin; y_cur != y_end; y_cur++) {
+            if(*y_cur == *x_begin) {
+               *z_back++ = *x_begin;
+               break;
+            }
+         }
+         return;
+      }
+
+      auto x_mid = x_size / 2;
+
+      workspace.table.assign(y_begin, y_end);
+      lcs_bit_row(x_begin, x_begin + x_mid, workspace.table, y_size, workspace.left);
+
+      workspace.table.assign(std::reverse_iterator<I>(y_end), std::reverse_iterator<I>(y_begin));
+      lcs_bit_row(std::reverse_iterator<I>(x_end), std::reverse_iterator<I>(x_begin + x_mid), workspace.table, y_size, workspace.right);
+
+      // walk the split point j across y keeping LCS(x[0, x_mid), y[0, j)) + LCS(x[x_mid, x_size), y[j, y_size)),
+      // the second is the number of 0 bits among the first y_size - j bits of the reversed row
+
+      const std::vector<uint64_t> &L = workspace.left, &R = workspace.right;
+
+      int_fast64_t left = 0, right = lcs_row_length(R, y_size);
+      int_fast64_t best = right, y_mid = 0;
+      for(int_fast64_t j = 1; j <= y_size; j++) {
+         int_fast64_t l = j - 1, r = y_size - j;
+         left += !((L[l / 64] >> (l % 64)) & 1);
+         right -= !((R[r / 64] >> (r % 64)) & 1);
+         if(left + right > best) {
+            best = left + right;
+            y_mid = j;
+         }
+      }
+
+      lcs_step(x_begin, x_begin + x_mid, y_begin, y_begin + y_mid, z_back, workspace);
+      lcs_step(x_begin + x_mid, x_end, y_begin + y_mid, y_end, z_back, workspace);
+   }
+
+   // The length of the longest common subsequence of x and y
+
+   template<typename I>
+   int_fast64_t lcs_length(I x_begin, I x_end, I y_begin, I y_end)
+   {
+      typedef typename std::iterator_traits<I>::value_type I_type;
+
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      lcs_match_table<I_type> table;
+      std::vector<uint64_t>   V;
+
+      table.assign(y_begin, y_end);
+      lcs_bit_row(x_begin, x_end, table, y_size, V);
+      return lcs_row_length(V, y_size);
+   }
+
+   // 2 * lcs_length() / (x_size + y_size), 1 for identical sequences and 0 when nothing is in common
+
+   template<typename I>
+   double lcs_similarity(I x_begin, I x_end, I y_begin, I y_end)
+   {
+      int_fast64_t sizes = std::distance(x_begin, x_end) + std::distance(y_begin, y_end);
+      return sizes == 0 ? 1.0 : 2.0 * lcs_length(x_begin, x_end, y_begin, y_end) / sizes;
+   }
+
    // given two strings return the LCS
-   
+   // found with Hirschberg's recursion over bit-parallel rows, linear space and no limit on the length
+
    template<typename I, typename BI>
-   void longest_common_subsequence(I x_begin, I x_end, I y_begin, I y_end, BI z_back, 
+   void longest_common_subsequence(I x_begin, I x_end, I y_begin, I y_end, BI z_back,
       typename std::iterator_traits<I>::value_type deleted_value = '-')
    {
       typedef typename std::iterator_traits<I>::value_type I_type;
 
-      std::vector<I_type>  s, t;
-
-      auto zero_one = [](const char &x, const char &y) -> int16_t { return x == y ? 1 : 0; };
-      Hirschberg(x_begin, x_end, y_begin, y_end, std::back_inserter(s), std::back_inserter(t), zero_one, 0);
-      for(auto s_cur = s.begin(), t_cur = t.begin(); s_cur != s.end() && t_cur != t.end(); s_cur++, t_cur++) {
-         if(*s_cur == *t_cur) *z_back = *s_cur;
-      }
+      lcs_workspace<I_type> workspace;
+      lcs_step(x_begin, x_end, y_begin, y_end, z_back, workspace);
    }
 
 #ifdef HAVE_CUNIT_CUNIT_H
@@ -54,7 +252,42 @@ namespace stringAlgorithms {
       return;
 
    }
+
+   void lcs_bit_parallel_test(void)
+   {
+      // long enough for the carry to cross several words, checked against the Needleman-Wunsch score with zero_one
+      std::string x, y;
+      for(int k = 0; k < 5; k++) {
+         x += "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+         y += "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+      }
+
+      auto zero_one = [](const char &a, const char &b) -> int16_t { return a == b ? 1 : 0; };
+      int_fast64_t expected = nwScore(x.begin(), x.end(), y.begin(), y.end(), zero_one, 0).back();
+
+      CU_ASSERT(lcs_length(x.begin(), x.end(), y.begin(), y.end()) == expected);
+      CU_ASSERT(lcs_length(y.begin(), y.end(), x.begin(), x.end()) == expected);
+
+      std::string s;
+      longest_common_subsequence(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(s));
+      CU_ASSERT((int_fast64_t)s.size() == expected);
+
+      // s is a subsequence of both
+      auto x_cur = x.begin(), y_cur = y.begin();
+      for(auto c : s) {
+         while(x_cur != x.end() && *x_cur != c) x_cur++;
+         while(y_cur != y.end() && *y_cur != c) y_cur++;
+         CU_ASSERT(x_cur != x.end() && y_cur != y.end());
+         if(x_cur == x.end() || y_cur == y.end()) break;
+         x_cur++; y_cur++;
+      }
+
+      // elements which aren't bytes go through the std::map table
+      std::vector<std::string> a = { "one", "two", "three", "four" }, b = { "zero", "two", "four", "five" };
+      CU_ASSERT(lcs_length(a.begin(), a.end(), b.begin(), b.end()) == 2);
+      return;
+   }
 #endif // HAVE_CUNIT_CUNIT_H
-} // stringAlgorithms 
+} // stringAlgorithms
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,213 @@
+#ifndef LOCAL_HPP
+#define LOCAL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+#include "nwrow.hpp"
+
+namespace stringAlgorithms {
+
+   // Local (Smith-Waterman) and semi-global alignment in linear space
+   //
+   // One sweep of the rows in the given nw_mode finds the best cell, the end of the aligned region. The start is
+   // found by sweeping back from there with the global recurrence over the reversed prefixes, the first cell which
+   // reaches the best score is where the region begins (nothing can score more or there would be a better region).
+   // The region is then globally aligned by Hirschberg, so only a few rows are ever kept.
+
+   // The part of x and y an alignment covers, [x_begin, x_end) and [y_begin, y_end) as offsets
+
+   template<typename P>
+   struct alignment_region {
+      P              score;
+      int_fast64_t   x_begin, x_end, y_begin, y_end;
+   };
+
+   // The best cell in the given mode, the region ends there and begins at (0, 0) until nw_best_region() finds the start
+   // ties go to the first cell in row order
+
+   template<typename I, typename F>
+   alignment_region<typename PP<F, I>::type>
+   nw_best_cell(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1, nw_mode mode = NW_LOCAL)
+   {
+      typedef typename PP<F, I>::type P;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      std::vector<P> top(y_size + 1), bottom(y_size + 1);
+      P *top_row = top.data(), *bottom_row = bottom.data();
+
+      nw_row_sweep<I, F> sweep(y_begin, y_end, score_function, ID);
+
+      alignment_region<P> best = { 0, 0, 0, 0, 0 };
+
+      sweep.first_row(top_row);
+      nw_mode_first_row(top_row, y_size, mode);
+      int_fast64_t i = 1;
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++, i++) {
+         sweep(*x_cur, top_row, bottom_row);
+         nw_mode_row(bottom_row, y_size, mode);
+         std::swap(top_row, bottom_row);
+         if(mode == NW_LOCAL) {
+            auto found = std::max_element(top_row, top_row + y_size + 1);
+            if(*found > best.score) best.score = *found, best.x_end = i, best.y_end = found - top_row;
+         }
+      }
+
+      if(mode == NW_SEMI_GLOBAL) {
+         auto found = std::max_element(top_row, top_row + y_size + 1);
+         best.score = *found, best.x_end = x_size, best.y_end = found - top_row;
+      } else if(mode == NW_GLOBAL) {
+         best.score = top_row[y_size], best.x_end = x_size, best.y_end = y_size;
+      }
+      return best;
+   }
+
+   // The region of the best alignment in the given mode, the smallest one if several reach the best score
+
+   template<typename I, typename F>
+   alignment_region<typename PP<F, I>::type>
+   nw_best_region(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1, nw_mode mode = NW_LOCAL)
+   {
+      typedef typename PP<F, I>::type  P;
+      typedef std::reverse_iterator<I> R;
+
+      alignment_region<P> best = nw_best_cell(x_begin, x_end, y_begin, y_end, score_function, ID, mode);
+
+      // the global region is everything and a local one with nothing above 0 is empty
+      if(mode == NW_GLOBAL) return best;
+      if(mode == NW_LOCAL && best.score <= 0) {
+         best.x_begin = best.x_end;
+         best.y_begin = best.y_end;
+         return best;
+      }
+
+      // back from the best cell over x[0, x_end) and y[0, y_end) reversed, all of x in the semi-global mode
+      R x_rbegin(x_begin + best.x_end), x_rend(x_begin), y_rbegin(y_begin + best.y_end), y_rend(y_begin);
+
+      std::vector<P> top(best.y_end + 1), bottom(best.y_end + 1);
+      P *top_row = top.data(), *bottom_row = bottom.data();
+
+      nw_row_sweep<R, F> sweep(y_rbegin, y_rend, score_function, ID);
+
+      sweep.first_row(top_row);
+      int_fast64_t i = 0;
+      for(auto x_cur = x_rbegin; ; x_cur++, i++) {
+         if(mode == NW_LOCAL || i == best.x_end) {
+            auto found = std::find(top_row, top_row + best.y_end + 1, best.score);
+            if(found != top_row + best.y_end + 1) {
+               best.x_begin = best.x_end - i;
+               best.y_begin = best.y_end - (found - top_row);
+               break;
+            }
+         }
+         if(x_cur == x_rend) break;
+         sweep(*x_cur, top_row, bottom_row);
+         std::swap(top_row, bottom_row);
+      }
+      return best;
+   }
+
+   // Align the best region of x and y in the given mode, the alignment of the region is written to w_back and z_back
+   // the iterators must be random access
+
+   template<typename I, typename BI, typename F>
+   alignment_region<typename PP<F, I>::type>
+   align_region(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, typename PP<F, I>::type ID,
+      const typename std::iterator_traits<I>::value_type deleted_value, nw_mode mode)
+   {
+      auto region = nw_best_region(x_begin, x_end, y_begin, y_end, score_function, ID, mode);
+      Hirschberg(x_begin + region.x_begin, x_begin + region.x_end, y_begin + region.y_begin, y_begin + region.y_end, w_back, z_back,
+         score_function, ID, deleted_value);
+      return region;
+   }
+
+   // The best scoring alignment of part of x against part of y
+
+   template<typename I, typename BI, typename F>
+   alignment_region<typename PP<F, I>::type>
+   SmithWaterman(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, typename PP<F, I>::type ID = -1,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      return align_region(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value, NW_LOCAL);
+   }
+
+   // The best scoring alignment of all of x against part of y, where x fits best in y
+
+   template<typename I, typename BI, typename F>
+   alignment_region<typename PP<F, I>::type>
+   SemiGlobal(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, typename PP<F, I>::type ID = -1,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      return align_region(x_begin, x_end, y_begin, y_end, w_back, z_back, score_function, ID, deleted_value, NW_SEMI_GLOBAL);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_local_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_local_suite(void)
+   {
+      return 0;
+   }
+
+   void local_test(void)
+   {
+      // https://en.wikipedia.org/wiki/Smith%E2%80%93Waterman_algorithm
+      std::string x = "TGTTACGG";
+      std::string y = "GGTTGACTA";
+
+      auto three_three = [](const char &a, const char &b) -> int16_t { return a == b ? 3 : -3; };
+
+      std::vector<std::string> result(2, std::string()), expected = { "GTT-AC", "GTTGAC" };
+      auto region = SmithWaterman(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+         three_three, -2);
+
+      CU_ASSERT(region.score == 13 && region.x_begin == 1 && region.x_end == 6 && region.y_begin == 1 && region.y_end == 7);
+      CU_ASSERT(result == expected);
+      if(result != expected) {
+         std::cout << std::endl;
+         std::cout << "result[0] = " << result[0] << std::endl;
+         std::cout << "result[1] = " << result[1] << std::endl;
+      }
+
+      // the local rows match the full matrix, long enough for the SIMD rows
+      std::string a = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string b = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+      for(nw_mode mode : { NW_LOCAL, NW_SEMI_GLOBAL }) {
+         auto matrix = nw_score_matrix(a.begin(), a.end(), b.begin(), b.end(), three_three, -2, mode);
+         CU_ASSERT(nwScore(a.begin(), a.end(), b.begin(), b.end(), three_three, -2, mode) == matrix.back());
+      }
+
+      // where a query fits in a reference
+      x = "GATTACA";
+      y = "CCCCGATCACACCCC";
+      result.assign(2, std::string());
+      expected = { "GATTACA", "GATCACA" };
+      region = SemiGlobal(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+         scoring::plus_minus_one);
+
+      CU_ASSERT(region.score == 5 && region.x_begin == 0 && region.x_end == 7 && region.y_begin == 4 && region.y_end == 11);
+      CU_ASSERT(result == expected);
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // LOCAL_HPP
@@ -1,7 +1,9 @@
 #ifndef NEEDLEMANWUNSCH_HPP
 #define NEEDLEMANWUNSCH_HPP
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <iterator>
@@ -15,90 +17,357 @@
 #endif
 
 #include "stringUtility.hpp"
+#include "nwrow.hpp"
 
 namespace stringAlgorithms {
 
+   // A rows x cols matrix held in one contiguous row-major buffer
+   // resize() keeps the capacity so a matrix can be reused between calls
+
+   template<typename P>
+   class flat_matrix {
+   public:
+      flat_matrix() : rows_(0), cols_(0) {}
+      flat_matrix(int_fast64_t rows, int_fast64_t cols) : rows_(rows), cols_(cols), data_(rows * cols, 0) {}
+
+      void resize(int_fast64_t rows, int_fast64_t cols) {
+         rows_ = rows; cols_ = cols;
+         data_.resize(rows * cols);
+      }
+
+      P &operator()(int_fast64_t i, int_fast64_t j) { return data_[i * cols_ + j]; }
+      const P &operator()(int_fast64_t i, int_fast64_t j) const { return data_[i * cols_ + j]; }
+
+      P *row(int_fast64_t i) { return data_.data() + i * cols_; }
+      const P *row(int_fast64_t i) const { return data_.data() + i * cols_; }
+
+      int_fast64_t rows() const { return rows_; }
+      int_fast64_t cols() const { return cols_; }
+
+   private:
+      int_fast64_t      rows_, cols_;
+      std::vector<P>    data_;
+   };
+
+   // The move which produced the score in a cell 
+   // NW_DIAG is a match/substitution, NW_UP a deletion from x, NW_LEFT an insertion from y
+
+   enum nw_move : uint8_t { NW_DIAG = 0, NW_UP = 1, NW_LEFT = 2 };
+
+   // What is being aligned
+   // NW_GLOBAL all of x against all of y, NW_LOCAL (Smith-Waterman) the best scoring part of x against part of y,
+   // no cell scores below 0, NW_SEMI_GLOBAL all of x against part of y, gaps before and after y are free so row 0
+   // is 0 and the best cell is anywhere in the last row. The local modes need ID <= 0.
+
+   enum nw_mode : uint8_t { NW_GLOBAL = 0, NW_LOCAL = 1, NW_SEMI_GLOBAL = 2 };
+
+   // Apply a mode to a row computed by the global recurrence
+   // clamping a finished row at 0 is the same as clamping every cell as it is computed since a left move out of a
+   // clamped cell can't score above 0 when ID <= 0
+
+   template<typename P>
+   void nw_mode_row(P *row, int_fast64_t y_size, nw_mode mode) {
+      if(mode == NW_LOCAL) {
+         for(int_fast64_t j = 0; j <= y_size; j++) row[j] = std::max<P>(row[j], 0);
+      }
+   }
+
+   template<typename P>
+   void nw_mode_first_row(P *row, int_fast64_t y_size, nw_mode mode) {
+      if(mode != NW_GLOBAL) std::fill(row, row + y_size + 1, P(0));
+   }
+
+   // The nw_move for every cell of the score matrix packed 2 bits per cell, 4 cells per byte
+   // this is all that's needed for traceback so the scores themselves can be dropped a row at a time
+
+   class traceback_plane {
+   public:
+      traceback_plane() : rows_(0), cols_(0), stride_(0) {}
+
+      void resize(int_fast64_t rows, int_fast64_t cols) {
+         rows_ = rows; cols_ = cols; stride_ = (cols + 3) / 4;
+         data_.resize(rows * stride_);
+      }
+
+      uint8_t *row(int_fast64_t i) { return data_.data() + i * stride_; }
+      const uint8_t *row(int_fast64_t i) const { return data_.data() + i * stride_; }
+
+      static void set(uint8_t *row, int_fast64_t j, nw_move m) {
+         int shift = 2 * (j & 3);
+         row[j >> 2] = (row[j >> 2] & ~(3 << shift)) | (m << shift);
+      }
+
+      static nw_move get(const uint8_t *row, int_fast64_t j) {
+         return static_cast<nw_move>((row[j >> 2] >> (2 * (j & 3))) & 3);
+      }
+
+      nw_move operator()(int_fast64_t i, int_fast64_t j) const { return get(row(i), j); }
+
+      int_fast64_t rows() const { return rows_; }
+      int_fast64_t cols() const { return cols_; }
+
+   private:
+      int_fast64_t            rows_, cols_, stride_;
+      std::vector<uint8_t>    data_;
+   };
+
+   // Compute the Needleman-Wunsch score matrix into a single flat buffer
+
+   template<typename I, typename F>
+   flat_matrix<typename PP<F, I>::type>
+   nw_flat_score_matrix(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1,
+      nw_mode mode = NW_GLOBAL)
+   {
+      typedef typename PP<F,I>::type P;
+
+      auto x_size = std::distance(x_begin, x_end);
+      auto y_size = std::distance(y_begin, y_end);
+
+      flat_matrix<P> score(x_size + 1, y_size + 1);
+
+      P *top = score.row(0);
+      top[0] = 0;
+      for(auto j = 1; j <= y_size; j++) top[j] = top[j-1] + ID;
+      nw_mode_first_row(top, y_size, mode);
+
+      auto x_cur = x_begin;
+      for(auto i = 1; i <= x_size; i++) {
+         P *bottom = score.row(i);
+         bottom[0] = top[0] + ID;
+         if(mode == NW_LOCAL) bottom[0] = std::max<P>(bottom[0], 0);
+         auto y_cur = y_begin;
+         for(auto j = 1; j <= y_size; j++) {
+            P score_sub = top[j-1] + score_function(*x_cur, *y_cur);
+            P score_del = top[j] + ID;
+            P score_ins = bottom[j-1] + ID;
+            bottom[j] = std::max({score_sub, score_del, score_ins});
+            if(mode == NW_LOCAL) bottom[j] = std::max<P>(bottom[j], 0);
+            y_cur++;
+         }
+         x_cur++;
+         top = bottom;
+      }
+
+      return score;
+   }
+
    // Compute the Needleman-Wunsch score matrix on a type 
-   // look at use of std::function on large strings sometime
+   // this is the original interface and is kept for compatibility, it copies out of nw_flat_score_matrix()
    
    template<typename I, typename F>
    std::vector<std::vector< typename PP<F, I>::type >> 
-   nw_score_matrix(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1)
+   nw_score_matrix(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1,
+      nw_mode mode = NW_GLOBAL)
    {
+      typedef typename PP<F,I>::type P;
+
+      auto flat = nw_flat_score_matrix(x_begin, x_end, y_begin, y_end, std::forward<F>(score_function), ID, mode);
+
+      std::vector<std::vector<P>> score;
+      score.reserve(flat.rows());
+      for(int_fast64_t i = 0; i < flat.rows(); i++) score.emplace_back(flat.row(i), flat.row(i) + flat.cols());
+
+      return score;
+   }
+
+   // Fill rows 1..x_size of the traceback plane from the scores of row 0 in top, moves must already have x_size + 1
+   // rows and row 0 of it is left alone, so a block of rows can be redone from a stored row of scores
 
+   template<typename I, typename F>
+   typename PP<F, I>::type
+   nw_traceback_rows(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, traceback_plane &moves, typename PP<F, I>::type ID,
+      typename PP<F, I>::type *top, typename PP<F, I>::type *bottom, std::vector<typename PP<F, I>::type> *, std::false_type)
+   {
       typedef typename PP<F,I>::type P;
-      
+
       auto x_size = std::distance(x_begin, x_end);
       auto y_size = std::distance(y_begin, y_end);
 
-      std::vector<std::vector<P>> score(x_size + 1, std::vector<P>(y_size + 1, 0));
-
-      score[0][0] = 0;
-      for(auto j = 1; j <= y_size; j++) score[0][j] = score[0][j-1] + ID; 
-
       auto x_cur = x_begin;
       for(auto i = 1; i <= x_size; i++) {
-         score[i][0] = score[i-1][0] + ID;
+         uint8_t *move_row = moves.row(i);
+         bottom[0] = top[0] + ID;
+         traceback_plane::set(move_row, 0, NW_UP);
          auto y_cur = y_begin;
          for(auto j = 1; j <= y_size; j++) {
-            P score_sub = score[i-1][j-1] + score_function(*x_cur, *y_cur);
-            P score_del = score[i-1][j] + ID;
-            P score_ins = score[i][j-1] + ID;
-            score[i][j] = std::max({score_sub, score_del, score_ins});
+            P score_sub = top[j-1] + score_function(*x_cur, *y_cur);
+            P score_del = top[j] + ID;
+            P score_ins = bottom[j-1] + ID;
+            if(score_sub >= score_del && score_sub >= score_ins) {
+               bottom[j] = score_sub;
+               traceback_plane::set(move_row, j, NW_DIAG);
+            } else if(score_del >= score_ins) {
+               bottom[j] = score_del;
+               traceback_plane::set(move_row, j, NW_UP);
+            } else {
+               bottom[j] = score_ins;
+               traceback_plane::set(move_row, j, NW_LEFT);
+            }
             y_cur++;
          }
          x_cur++;
+         std::swap(top, bottom);
       }
 
-      return score;
+      return top[y_size];
    }
 
-   template<typename I, typename BI, typename F>
-   void NeedlemanWunsch(I x_begin, I x_end, I y_begin, I y_end, BI w_back, BI z_back, F &&score_function, typename PP<F, I>::type ID = -1,
-      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+#if STRINGALGORITHMS_SIMD
+
+   // the rows are computed by the SIMD nw_row_sweep and the move into each cell is found by comparing the score
+   // with the up-left and up scores, using the sweep's lookup table rather than the score function
+   // the comparisons are done a vector at a time and packed straight into the plane
+
+   template<typename I, typename F>
+   typename PP<F, I>::type
+   nw_traceback_rows(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, traceback_plane &moves, typename PP<F, I>::type ID,
+      typename PP<F, I>::type *top, typename PP<F, I>::type *bottom, std::vector<typename PP<F, I>::type> *profile, std::true_type)
    {
       typedef typename PP<F,I>::type P;
-      typedef typename std::iterator_traits<I>::value_type I_type;
 
-      std::vector<std::vector<I_type>> result(2, std::vector<I_type>());
+      auto x_size = std::distance(x_begin, x_end);
+      auto y_size = std::distance(y_begin, y_end);
+
+      typedef simd::i16 V;
+
+      nw_row_sweep<I, F> sweep(y_begin, y_end, score_function, ID, profile);
+
+      auto id = V::set1(ID);
+      auto up_code = V::set1(NW_UP);
+      auto left_code = V::set1(NW_LEFT);
+
+      auto x_cur = x_begin;
+      for(auto i = 1; i <= x_size; i++, x_cur++) {
+         sweep(*x_cur, top, bottom);
+         const P *prof = sweep.profile(*x_cur);
+         uint8_t *move_row = moves.row(i);
+         traceback_plane::set(move_row, 0, NW_UP);
+
+         // cells 1..3 share a byte with cell 0, after that whole vectors of moves start on a byte
+         int_fast64_t j = 1;
+         for(; j <= y_size && j < 4; j++) {
+            P score_sub = top[j-1] + prof[j];
+            P score_del = top[j] + ID;
+            traceback_plane::set(move_row, j, bottom[j] == score_sub ? NW_DIAG : (bottom[j] == score_del ? NW_UP : NW_LEFT));
+         }
+         for(; j + V::lanes - 1 <= y_size; j += V::lanes) {
+            auto b = V::load(bottom + j);
+            auto diag = V::cmpeq(b, V::adds(V::load(top + j - 1), V::load(prof + j)));
+            auto up = V::cmpeq(b, V::adds(V::load(top + j), id));
+            auto code = V::bit_andnot(diag, V::bit_or(V::bit_and(up, up_code), V::bit_andnot(up, left_code)));
+            V::pack_2bit(code, move_row + (j >> 2));
+         }
+         for(; j <= y_size; j++) {
+            P score_sub = top[j-1] + prof[j];
+            P score_del = top[j] + ID;
+            traceback_plane::set(move_row, j, bottom[j] == score_sub ? NW_DIAG : (bottom[j] == score_del ? NW_UP : NW_LEFT));
+         }
+         std::swap(top, bottom);
+      }
 
-      std::vector<std::vector<P>> score = nw_score_matrix(x_begin, x_end, y_begin, y_end, std::move(score_function), ID);
+      return top[y_size];
+   }
+
+#endif // STRINGALGORITHMS_SIMD
+
+   // Fill the traceback plane for x and y keeping only two rows of scores, returns the score of the alignment
+   // Ties are broken diagonal, then up, then left which is the order the traceback has always checked them
+   // top and bottom are scratch rows of at least y_size + 1 scores, profile is passed on to nw_row_sweep
+
+   template<typename I, typename F>
+   typename PP<F, I>::type
+   nw_traceback_matrix(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, traceback_plane &moves, typename PP<F, I>::type ID,
+      typename PP<F, I>::type *top, typename PP<F, I>::type *bottom, std::vector<typename PP<F, I>::type> *profile = nullptr)
+   {
+      auto x_size = std::distance(x_begin, x_end);
+      auto y_size = std::distance(y_begin, y_end);
+
+      moves.resize(x_size + 1, y_size + 1);
 
+      uint8_t *move_row = moves.row(0);
+      nw_row_sweep<I, F>(y_begin, y_end, score_function, ID).first_row(top);
+      traceback_plane::set(move_row, 0, NW_DIAG);
+      for(auto j = 1; j <= y_size; j++) traceback_plane::set(move_row, j, NW_LEFT);
+
+      return nw_traceback_rows(x_begin, x_end, y_begin, y_end, score_function, moves, ID, top, bottom, profile,
+         std::integral_constant<bool, nw_simd_eligible<I, F>::value>());
+   }
+
+   template<typename I, typename F>
+   typename PP<F, I>::type
+   nw_traceback_matrix(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, traceback_plane &moves, typename PP<F, I>::type ID = -1)
+   {
+      typedef typename PP<F,I>::type P;
+
+      auto y_size = std::distance(y_begin, y_end);
+
+      std::vector<P>    top(y_size + 1);
+      std::vector<P>    bottom(y_size + 1);
+
+      return nw_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, moves, ID, top.data(), bottom.data());
+   }
+
+   // Walk a filled traceback_plane back from the last cell to [0][0] appending the alignment to w and z in reverse order
+   // the move recorded for each cell tells us whether we arrived by a match/substitution (up left),
+   // a deletion (up) or an insertion (left) so nothing has to be rescored
+
+   template<typename I, typename T>
+   void nw_traceback_reversed(const traceback_plane &moves, I x_begin, I x_end, I y_begin, I y_end, std::vector<T> &w, std::vector<T> &z,
+      const T deleted_value)
+   {
       int_fast64_t   i = std::distance(x_begin, x_end);
       int_fast64_t   j = std::distance(y_begin, y_end);
 
-      auto x_cur = x_end - 1;
-      auto y_cur = y_end - 1;
-
-      // work our way back to [0][0] constructing the strings in reverse order
-      // we first see if we arrived by an match/substitution, if so up left
-      // then we see if we arrived via deletion and if so move up 
-      // then we must left 
+      auto x_cur = x_end;
+      auto y_cur = y_end;
 
       while(i != 0 || j != 0) {
-         if((i > 0 && j > 0) && score[i][j] == score[i-1][j-1] + score_function(*x_cur, *y_cur)) {
-            result[0].push_back(*x_cur);
-            result[1].push_back(*y_cur);
-            i--; j--;
-            x_cur--; y_cur--;
-         }
-         else if((i > 0) && (score[i][j] == score[i-1][j] + ID)) {
-            result[0].push_back(*x_cur);
-            result[1].push_back(deleted_value);
-            i--;     
-            x_cur--;   
-         }
-         else {
-            result[0].push_back(deleted_value);
-            result[1].push_back(*y_cur);
-            j--;
-            y_cur--;      
+         switch(moves(i, j)) {
+            case NW_DIAG:
+               --x_cur; --y_cur;
+               w.push_back(*x_cur);
+               z.push_back(*y_cur);
+               i--; j--;
+               break;
+            case NW_UP:
+               --x_cur;
+               w.push_back(*x_cur);
+               z.push_back(deleted_value);
+               i--;
+               break;
+            default:
+               --y_cur;
+               w.push_back(deleted_value);
+               z.push_back(*y_cur);
+               j--;
+               break;
          }
       }
-      for(auto &i : result) std::reverse(i.begin(), i.end()); 
+   }
+
+   // Walk a filled traceback_plane writing the alignment to w_back and z_back
+
+   template<typename I, typename BI>
+   void nw_traceback(const traceback_plane &moves, I x_begin, I x_end, I y_begin, I y_end, BI w_back, BI z_back,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      typedef typename std::iterator_traits<I>::value_type I_type;
+
+      std::vector<std::vector<I_type>> result(2, std::vector<I_type>());
 
-      std::copy(result[0].begin(), result[0].end(), w_back);
-      std::copy(result[1].begin(), result[1].end(), z_back);
+      nw_traceback_reversed(moves, x_begin, x_end, y_begin, y_end, result[0], result[1], deleted_value);
+
+      std::copy(result[0].rbegin(), result[0].rend(), w_back);
+      std::copy(result[1].rbegin(), result[1].rend(), z_back);
+   }
+
+   template<typename I, typename BI, typename F>
+   void NeedlemanWunsch(I x_begin, I x_end, I y_begin, I y_end, BI w_back, BI z_back, F &&score_function, typename PP<F, I>::type ID = -1,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      traceback_plane moves;
+      nw_traceback_matrix(x_begin, x_end, y_begin, y_end, std::forward<F>(score_function), moves, ID);
+      nw_traceback(moves, x_begin, x_end, y_begin, y_end, w_back, z_back, deleted_value);
 
       return;
    }
@@ -138,6 +407,33 @@ namespace stringAlgorithms {
    }
 
 
+   void nw_traceback_plane_test(void)
+   {
+      std::string x = "GATTACA";
+      std::string y = "GCATGCU";
+
+      auto flat = nw_flat_score_matrix(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one);
+      auto matrix = nw_score_matrix(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one);
+
+      bool same = flat.rows() == (int_fast64_t)matrix.size() && flat.cols() == (int_fast64_t)matrix[0].size();
+      for(int_fast64_t i = 0; same && i < flat.rows(); i++) {
+         for(int_fast64_t j = 0; j < flat.cols(); j++) same = same && flat(i, j) == matrix[i][j];
+      }
+      CU_ASSERT(same);
+
+      traceback_plane moves;
+      int16_t score = nw_traceback_matrix(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one, moves);
+
+      CU_ASSERT(score == 0);
+      CU_ASSERT(moves(0, 3) == NW_LEFT);
+      CU_ASSERT(moves(3, 0) == NW_UP);
+      CU_ASSERT(moves(1, 1) == NW_DIAG);
+      CU_ASSERT(moves(7, 7) == NW_DIAG);
+      CU_ASSERT(moves(3, 5) == NW_LEFT);
+      CU_ASSERT(moves(5, 4) == NW_UP);
+      return;
+   }
+
    // used as a function pointer to test being passed to NeedlemanWunsch
    int16_t nw_test_pmofp(char a, char b) {
       return a == b ? 1 : -1;
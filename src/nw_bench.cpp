@@ -6,8 +6,10 @@
 #include <unistd.h>
 
 #include "needlemanwunsch.hpp"
+#include "aligner.hpp"
 #include "stringoutput.hpp"
 
+using stringAlgorithms::Aligner;
 using stringAlgorithms::NeedlemanWunsch;
 using stringAlgorithms::display_diff;
 using stringAlgorithms::scoring::plus_minus_one;
@@ -28,11 +30,11 @@ int main(int argc, char *argv[])
    int16_t  count = 1000;
    int      c;
 
-   enum function_type { POINTER, FUNCTOR, LAMBDA, STD_FUNCTION };
+   enum function_type { POINTER, FUNCTOR, LAMBDA, STD_FUNCTION, ALIGNER };
 
    function_type f_type = LAMBDA;
 
-   while((c = getopt(argc, argv, "pflsn:")) != -1) {
+   while((c = getopt(argc, argv, "pflsan:")) != -1) {
       switch(c) {
          case 'p':
             f_type = POINTER;
@@ -46,6 +48,9 @@ int main(int argc, char *argv[])
          case 's':
             f_type = STD_FUNCTION;
             break;
+         case 'a':
+            f_type = ALIGNER;
+            break;
          case 'n':
             count = atoi(optarg);
             break;
@@ -126,6 +131,17 @@ int main(int argc, char *argv[])
             s.erase(); t.erase();
          }
          break;   
+      case ALIGNER:
+         {
+            // the lambda with the buffers kept from one call to the next
+            Aligner<int16_t> aligner;
+            for(int16_t i=0; i < count; i++) {
+               aligner.align(x.begin(), x.end(), y.begin(), y.end(), plus_minus_one);
+               aligner.align(x.begin(), x.end(), z.begin(), z.end(), plus_minus_one);
+               aligner.align(y.begin(), y.end(), z.begin(), z.end(), plus_minus_one);
+            }
+         }
+         break;
    }
 
    return 0;
@@ -0,0 +1,249 @@
+#ifndef NWROW_HPP
+#define NWROW_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "simd.hpp"
+#include "stringUtility.hpp"
+
+namespace stringAlgorithms {
+
+   // nw_row_sweep computes one row of the Needleman-Wunsch score matrix from the row above it
+   //
+   //    sweep.first_row(top);
+   //    for each x: sweep(x, top, bottom); swap(top, bottom);
+   //
+   // top and bottom must hold y_size + 1 scores. profile, if given, is used to hold the lookup tables so that
+   // its memory can be reused between sweeps.
+   //
+   // When the elements are single bytes and the score type is int16_t the score function is turned into a
+   // lookup table (a profile of score(c, y[j]) for every symbol c as it is first seen in x) and the row is computed
+   // in saturating SIMD lanes. The up-left and up moves are independent across the row, the left moves are a
+   // running maximum which is done as a prefix scan within each vector and carried between vectors. The SIMD sweep
+   // notes whether any cell saturated, see adaptive_alignment_score() in score.hpp.
+   // Everything else uses the scalar loop, which also reads from a profile when the score function is a
+   // substitution matrix over byte elements so the inner loop is a table lookup rather than a call.
+
+   template<typename I, typename F>
+   struct nw_simd_eligible {
+      typedef typename std::iterator_traits<I>::value_type I_type;
+      static const bool value = STRINGALGORITHMS_SIMD && sizeof(I_type) == 1 && std::is_integral<I_type>::value
+         && std::is_same<typename PP<F, I>::type, int16_t>::value;
+   };
+
+   template<typename I, typename F>
+   struct nw_profile_eligible {
+      typedef typename std::iterator_traits<I>::value_type I_type;
+      static const bool value = is_substitution_matrix<F>::value && sizeof(I_type) == 1 && std::is_integral<I_type>::value;
+   };
+
+   // Fill row[1..y_size] with score(x, y[j-1]), a substitution matrix is read through its alphabet indices
+
+   template<typename I, typename F, typename P>
+   void nw_profile_row(const typename std::iterator_traits<I>::value_type &x, I y_begin, I y_end, F &score_function, P *row,
+      std::false_type)
+   {
+      row[0] = 0;
+      int_fast64_t j = 1;
+      for(auto y_cur = y_begin; y_cur != y_end; y_cur++, j++) row[j] = score_function(x, *y_cur);
+   }
+
+   template<typename I, typename F, typename P>
+   void nw_profile_row(const typename std::iterator_traits<I>::value_type &x, I y_begin, I y_end, F &, P *row, std::true_type)
+   {
+      typedef typename std::decay<F>::type M;
+
+      const int16_t *index = alphabet_index<M>();
+      int x_index = index[static_cast<unsigned char>(x)];
+      row[0] = 0;
+      int_fast64_t j = 1;
+      for(auto y_cur = y_begin; y_cur != y_end; y_cur++, j++) row[j] = M::score_index(x_index, index[static_cast<unsigned char>(*y_cur)]);
+   }
+
+   template<typename I, typename F, bool = nw_simd_eligible<I, F>::value>
+   class nw_row_sweep {
+   public:
+      typedef typename PP<F, I>::type                       P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+      typedef typename std::remove_reference<F>::type       F_type;
+
+      typedef std::integral_constant<bool, nw_profile_eligible<I, F>::value> matrix;
+
+      nw_row_sweep(I y_begin, I y_end, F_type &score_function, P ID, std::vector<P> *profile = nullptr) :
+         y_begin_(y_begin), y_end_(y_end), y_size_(std::distance(y_begin, y_end)), score_function_(score_function), ID_(ID),
+         profile_(profile ? *profile : own_profile_)
+      {
+         profile_.clear();
+         std::fill(std::begin(index_), std::end(index_), -1);
+      }
+
+      int_fast64_t size() const { return y_size_; }
+
+      void first_row(P *top) const {
+         top[0] = 0;
+         for(int_fast64_t j = 1; j <= y_size_; j++) top[j] = top[j-1] + ID_;
+      }
+
+      void operator()(const I_type &x, const P *top, P *bottom) {
+         row(x, top, bottom, matrix());
+      }
+
+   private:
+      void row(const I_type &x, const P *top, P *bottom, std::false_type) {
+         bottom[0] = top[0] + ID_;
+         auto y_cur = y_begin_;
+         for(int_fast64_t j = 1; j <= y_size_; j++) {
+            P score_sub = top[j-1] + score_function_(x, *y_cur);
+            P score_del = top[j] + ID_;
+            P score_ins = bottom[j-1] + ID_;
+            bottom[j] = std::max({score_sub, score_del, score_ins});
+            y_cur++;
+         }
+      }
+
+      void row(const I_type &x, const P *top, P *bottom, std::true_type) {
+         auto c = static_cast<unsigned char>(x);
+         if(index_[c] < 0) {
+            index_[c] = profile_.size();
+            profile_.resize(profile_.size() + y_size_ + 1);
+            nw_profile_row(x, y_begin_, y_end_, score_function_, profile_.data() + index_[c], matrix());
+         }
+         const P *prof = profile_.data() + index_[c];
+
+         bottom[0] = top[0] + ID_;
+         for(int_fast64_t j = 1; j <= y_size_; j++) {
+            P score_sub = top[j-1] + prof[j];
+            P score_del = top[j] + ID_;
+            P score_ins = bottom[j-1] + ID_;
+            bottom[j] = std::max({score_sub, score_del, score_ins});
+         }
+      }
+
+      I                 y_begin_, y_end_;
+      int_fast64_t      y_size_;
+      F_type            &score_function_;
+      P                 ID_;
+      int_fast64_t      index_[256];
+      std::vector<P>    own_profile_;
+      std::vector<P>    &profile_;
+   };
+
+#if STRINGALGORITHMS_SIMD
+
+   // The SIMD sweep over lanes of V (simd::i16 or simd::i8), the scores are V::value_type and saturate rather than
+   // wrap. saturated() is true once any cell has reached the lowest or highest value, until then every cell is
+   // exact. The profile and the gap constants, up to V::lanes * ID, must fit in V::value_type.
+
+   template<typename I, typename F, typename V>
+   class nw_simd_row_sweep {
+   public:
+      typedef typename V::value_type                        P;
+      typedef typename std::iterator_traits<I>::value_type  I_type;
+      typedef typename std::remove_reference<F>::type       F_type;
+
+      nw_simd_row_sweep(I y_begin, I y_end, F_type &score_function, P ID, std::vector<P> *profile = nullptr) :
+         y_begin_(y_begin), y_end_(y_end), y_size_(std::distance(y_begin, y_end)), score_function_(score_function), ID_(ID),
+         profile_(profile ? *profile : own_profile_)
+      {
+         profile_.clear();
+         std::fill(std::begin(index_), std::end(index_), -1);
+         for(int s = 0; s < V::gap_steps; s++) gap_[s] = V::set1(simd::saturate<P>(ID * (int_fast64_t(1) << s)));
+         P ramp[V::lanes];
+         for(int l = 0; l < V::lanes; l++) ramp[l] = simd::saturate<P>((l + 1) * int_fast64_t(ID));
+         ramp_ = V::load(ramp);
+         id_ = V::set1(ID);
+         low_ = V::set1(std::numeric_limits<P>::max());
+         high_ = V::set1(std::numeric_limits<P>::min());
+         saturated_ = false;
+      }
+
+      int_fast64_t size() const { return y_size_; }
+
+      void first_row(P *top) {
+         top[0] = 0;
+         for(int_fast64_t j = 1; j <= y_size_; j++) top[j] = cell(int_fast64_t(top[j-1]) + ID_);
+      }
+
+      void operator()(const I_type &x, const P *top, P *bottom) {
+         const P *prof = profile(x);
+
+         bottom[0] = cell(int_fast64_t(top[0]) + ID_);
+         P carry = bottom[0];
+
+         int_fast64_t j = 1;
+         for(; j + V::lanes - 1 <= y_size_; j += V::lanes) {
+            auto v = V::max(V::adds(V::load(top + j - 1), V::load(prof + j)), V::adds(V::load(top + j), id_));
+            v = V::prefix_max(v, gap_);
+            v = V::max(v, V::adds(V::set1(carry), ramp_));
+            V::store(bottom + j, v);
+            low_ = V::min(low_, v);
+            high_ = V::max(high_, v);
+            carry = bottom[j + V::lanes - 1];
+         }
+         for(; j <= y_size_; j++) {
+            int_fast64_t score_sub = int_fast64_t(top[j-1]) + prof[j];
+            int_fast64_t score_del = int_fast64_t(top[j]) + ID_;
+            int_fast64_t score_ins = int_fast64_t(bottom[j-1]) + ID_;
+            bottom[j] = cell(std::max({score_sub, score_del, score_ins}));
+         }
+      }
+
+      // whether any cell so far has saturated
+      bool saturated() const {
+         P low[V::lanes], high[V::lanes];
+         V::store(low, low_);
+         V::store(high, high_);
+         bool found = saturated_;
+         for(int l = 0; l < V::lanes; l++) {
+            found = found || low[l] == std::numeric_limits<P>::min() || high[l] == std::numeric_limits<P>::max();
+         }
+         return found;
+      }
+
+      // the row of score(x, y[j-1]) for j in 1..y_size, built the first time x is seen
+      const P *profile(const I_type &x) {
+         auto c = static_cast<unsigned char>(x);
+         if(index_[c] < 0) {
+            index_[c] = profile_.size();
+            profile_.resize(profile_.size() + y_size_ + 1);
+            nw_profile_row(x, y_begin_, y_end_, score_function_, profile_.data() + index_[c],
+               std::integral_constant<bool, nw_profile_eligible<I, F>::value>());
+         }
+         return profile_.data() + index_[c];
+      }
+
+   private:
+      // a cell computed outside the lanes
+      P cell(int_fast64_t score) {
+         P p = simd::saturate<P>(score);
+         saturated_ = saturated_ || p == std::numeric_limits<P>::min() || p == std::numeric_limits<P>::max();
+         return p;
+      }
+
+      I                 y_begin_, y_end_;
+      int_fast64_t      y_size_;
+      F_type            &score_function_;
+      P                 ID_;
+      int_fast64_t      index_[256];
+      std::vector<P>    own_profile_;
+      std::vector<P>    &profile_;
+      typename V::type  gap_[V::gap_steps], ramp_, id_, low_, high_;
+      bool              saturated_;
+   };
+
+   template<typename I, typename F>
+   class nw_row_sweep<I, F, true> : public nw_simd_row_sweep<I, F, simd::i16> {
+   public:
+      using nw_simd_row_sweep<I, F, simd::i16>::nw_simd_row_sweep;
+   };
+
+#endif // STRINGALGORITHMS_SIMD
+
+} // stringAlgorithms
+
+#endif // NWROW_HPP
@@ -0,0 +1,340 @@
+#ifndef PACKED_HPP
+#define PACKED_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "hirschberg.hpp"
+#include "lcs.hpp"
+
+namespace stringAlgorithms {
+
+   // Nucleotides packed 2 bits to a base
+   //
+   // A, C, G and T are codes 0 to 3 packed 32 to a word, base i in bits 2 (i % 32) and 2 (i % 32) + 1 of word i / 32.
+   // Anything else is N, kept as a bit in a mask of its own which is only allocated once there is an N, so a sequence
+   // takes a quarter of the memory of a std::string. packed_iterator gives the bases back as upper case chars and is
+   // random access, so the engines take it like any other iterator.
+   //
+   // The kernels never unpack y. The bits of the columns of y holding a base, the match masks the bit-parallel rows
+   // are run from, come from 32 bases per word at once: the word xor the code in every field is 00 exactly where the
+   // base is the code, and those fields are gathered into one bit each. packed_lcs_length() runs the LCS rows of
+   // lcs.hpp over them and packed_edit_distance() Myers' bit-vector edit distance (Myers 1999, in the block form of
+   // Hyyro 2003), 64 columns per word operation. N matches N and nothing else, as the unpacked chars would.
+
+   enum { PACKED_N = 4 };
+
+   // the code of a base, PACKED_N for anything but A, C, G and T in either case
+
+   inline int packed_code(char c) {
+      switch(c) {
+         case 'A': case 'a': return 0;
+         case 'C': case 'c': return 1;
+         case 'G': case 'g': return 2;
+         case 'T': case 't': return 3;
+         default: return PACKED_N;
+      }
+   }
+
+   inline char packed_base(const uint64_t *words, const uint64_t *n_mask, int_fast64_t i) {
+      if(n_mask && ((n_mask[i / 64] >> (i % 64)) & 1)) return 'N';
+      return "ACGT"[(words[i / 32] >> (2 * (i % 32))) & 3];
+   }
+
+   // Random access over a packed_sequence, the bases are returned by value
+
+   class packed_iterator {
+   public:
+      typedef std::random_access_iterator_tag   iterator_category;
+      typedef char                              value_type;
+      typedef std::ptrdiff_t                    difference_type;
+      typedef const char                        *pointer;
+      typedef char                              reference;
+
+      packed_iterator() : words_(nullptr), n_mask_(nullptr), i_(0) {}
+      packed_iterator(const uint64_t *words, const uint64_t *n_mask, int_fast64_t i) : words_(words), n_mask_(n_mask), i_(i) {}
+
+      reference operator*() const { return packed_base(words_, n_mask_, i_); }
+      reference operator[](difference_type n) const { return packed_base(words_, n_mask_, i_ + n); }
+
+      // the code of the base, PACKED_N for N
+      int code() const { return n_mask_ && ((n_mask_[i_ / 64] >> (i_ % 64)) & 1) ? PACKED_N : (words_[i_ / 32] >> (2 * (i_ % 32))) & 3; }
+
+      packed_iterator &operator++() { ++i_; return *this; }
+      packed_iterator &operator--() { --i_; return *this; }
+      packed_iterator operator++(int) { packed_iterator t = *this; ++i_; return t; }
+      packed_iterator operator--(int) { packed_iterator t = *this; --i_; return t; }
+
+      packed_iterator &operator+=(difference_type n) { i_ += n; return *this; }
+      packed_iterator &operator-=(difference_type n) { i_ -= n; return *this; }
+
+      packed_iterator operator+(difference_type n) const { return packed_iterator(words_, n_mask_, i_ + n); }
+      packed_iterator operator-(difference_type n) const { return packed_iterator(words_, n_mask_, i_ - n); }
+      friend packed_iterator operator+(difference_type n, const packed_iterator &it) { return it + n; }
+      difference_type operator-(const packed_iterator &other) const { return i_ - other.i_; }
+
+      bool operator==(const packed_iterator &other) const { return i_ == other.i_; }
+      bool operator!=(const packed_iterator &other) const { return i_ != other.i_; }
+      bool operator<(const packed_iterator &other) const { return i_ < other.i_; }
+      bool operator>(const packed_iterator &other) const { return i_ > other.i_; }
+      bool operator<=(const packed_iterator &other) const { return i_ <= other.i_; }
+      bool operator>=(const packed_iterator &other) const { return i_ >= other.i_; }
+
+   private:
+      const uint64_t    *words_, *n_mask_;
+      int_fast64_t      i_;
+   };
+
+   // A nucleotide sequence at 2 bits a base, iterators are invalidated by anything which adds bases
+
+   class packed_sequence {
+   public:
+      typedef packed_iterator iterator;
+      typedef packed_iterator const_iterator;
+      typedef char            value_type;
+
+      packed_sequence() : size_(0) {}
+
+      template<typename I>
+      packed_sequence(I begin, I end) : size_(0) { assign(begin, end); }
+
+      explicit packed_sequence(const std::string &s) : size_(0) { assign(s.begin(), s.end()); }
+
+      template<typename I>
+      void assign(I begin, I end) {
+         clear();
+         reserve(std::distance(begin, end));
+         for(; begin != end; begin++) push_back(*begin);
+      }
+
+      void push_back(char c) {
+         int code = packed_code(c);
+         if(size_ % 32 == 0) words_.push_back(0);
+         if(!n_mask_.empty() && size_ % 64 == 0) n_mask_.push_back(0);
+         if(code == PACKED_N) {
+            if(n_mask_.empty()) n_mask_.resize(size_ / 64 + 1);
+            n_mask_[size_ / 64] |= uint64_t(1) << (size_ % 64);
+         } else {
+            words_[size_ / 32] |= uint64_t(code) << (2 * (size_ % 32));
+         }
+         size_++;
+      }
+
+      void reserve(int_fast64_t size) { words_.reserve((size + 31) / 32); }
+
+      void clear() {
+         words_.clear();
+         n_mask_.clear();
+         size_ = 0;
+      }
+
+      int_fast64_t size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+
+      char operator[](int_fast64_t i) const { return packed_base(words_.data(), n_mask(), i); }
+      int code(int_fast64_t i) const { return (begin() + i).code(); }
+
+      const_iterator begin() const { return const_iterator(words_.data(), n_mask(), 0); }
+      const_iterator end() const { return const_iterator(words_.data(), n_mask(), size_); }
+
+      // the packed bases, (size() + 31) / 32 words with the unused fields of the last 0
+      const uint64_t *words() const { return words_.data(); }
+
+      // a bit for each base set where it is N, (size() + 63) / 64 words, nullptr if there is no N
+      const uint64_t *n_mask() const { return n_mask_.empty() ? nullptr : n_mask_.data(); }
+
+      // the bytes of bases held
+      size_t bytes() const { return (words_.size() + n_mask_.size()) * sizeof(uint64_t); }
+
+   private:
+      std::vector<uint64_t>   words_, n_mask_;
+      int_fast64_t            size_;
+   };
+
+   // the 1 bits of the 2 bit fields of x gathered into the low 32 bits, field k to bit k
+
+   inline uint64_t packed_gather(uint64_t x) {
+      x &= 0x5555555555555555ull;
+      x = (x | (x >> 1)) & 0x3333333333333333ull;
+      x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0full;
+      x = (x | (x >> 4)) & 0x00ff00ff00ff00ffull;
+      x = (x | (x >> 8)) & 0x0000ffff0000ffffull;
+      x = (x | (x >> 16)) & 0x00000000ffffffffull;
+      return x;
+   }
+
+   // The bits of y for each code, one bit per base like lcs_match_table, assign() can be called again to reuse the memory
+
+   class packed_match_table {
+   public:
+      void assign(const packed_sequence &y) {
+         int_fast64_t size = y.size();
+         int_fast64_t packed_words = (size + 31) / 32;
+         words_ = lcs_words(size);
+         bits_.assign(5 * words_, 0);
+
+         const uint64_t *packed = y.words(), *n_mask = y.n_mask();
+         for(int code = 0; code < 4; code++) {
+            // the code in every field, the xor is 00 where the base is the code
+            uint64_t fields = uint64_t(code) * 0x5555555555555555ull;
+            uint64_t *M = bits_.data() + code * words_;
+            for(int_fast64_t w = 0; w < words_; w++) {
+               uint64_t t = packed[2 * w] ^ fields;
+               uint64_t m = packed_gather(~(t | (t >> 1)));
+               if(2 * w + 1 < packed_words) {
+                  t = packed[2 * w + 1] ^ fields;
+                  m |= packed_gather(~(t | (t >> 1))) << 32;
+               }
+               if(n_mask) m &= ~n_mask[w];
+               M[w] = m;
+            }
+         }
+         if(n_mask) std::copy(n_mask, n_mask + words_, bits_.begin() + PACKED_N * words_);
+
+         // the unused fields of the last word are A
+         if(size % 64) bits_[words_ - 1] &= (uint64_t(1) << (size % 64)) - 1;
+      }
+
+      const uint64_t *bits(int code) const { return bits_.data() + code * words_; }
+
+      // the bits of c, for lcs_bit_row()
+      const uint64_t *find(char c) const { return bits(packed_code(c)); }
+
+   private:
+      int_fast64_t            words_;
+      std::vector<uint64_t>   bits_;
+   };
+
+   // The length of the longest common subsequence of x and y
+
+   inline int_fast64_t packed_lcs_length(const packed_sequence &x, const packed_sequence &y)
+   {
+      packed_match_table      table;
+      std::vector<uint64_t>   V;
+
+      table.assign(y);
+      lcs_bit_row(x.begin(), x.end(), table, y.size(), V);
+      return lcs_row_length(V, y.size());
+   }
+
+   // The edit distance of x and y, the fewest substitutions, insertions and deletions that make x into y
+   // -nwScore() with 0 for a match, -1 for a mismatch and ID = -1
+   // Pv and Mv are the columns of y where the distance steps up and down going down a row, a row of x at a time
+
+   inline int_fast64_t packed_edit_distance(const packed_sequence &x, const packed_sequence &y, packed_match_table &table)
+   {
+      int_fast64_t x_size = x.size(), y_size = y.size();
+      if(y_size == 0) return x_size;
+
+      int_fast64_t words = lcs_words(y_size);
+      uint64_t last = uint64_t(1) << ((y_size - 1) % 64), high = uint64_t(1) << 63;
+
+      table.assign(y);
+      std::vector<uint64_t> Pv(words, ~uint64_t(0)), Mv(words, 0);
+
+      int_fast64_t distance = y_size;
+      for(auto x_cur = x.begin(); x_cur != x.end(); x_cur++) {
+         const uint64_t *Eq = table.bits(x_cur.code());
+
+         // the first row of the matrix steps up by 1 across x
+         int h = 1;
+         for(int_fast64_t w = 0; w < words; w++) {
+            uint64_t pv = Pv[w], mv = Mv[w], eq = Eq[w];
+            uint64_t h_minus = h < 0, h_plus = h > 0;
+
+            uint64_t xv = eq | mv;
+            eq |= h_minus;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+
+            uint64_t out = w == words - 1 ? last : high;
+            h = (ph & out ? 1 : 0) - (mh & out ? 1 : 0);
+
+            ph = (ph << 1) | h_plus;
+            mh = (mh << 1) | h_minus;
+            Pv[w] = mh | ~(xv | ph);
+            Mv[w] = ph & xv;
+         }
+         distance += h;
+      }
+      return distance;
+   }
+
+   inline int_fast64_t packed_edit_distance(const packed_sequence &x, const packed_sequence &y)
+   {
+      packed_match_table table;
+      return packed_edit_distance(x, y, table);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_packed_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_packed_suite(void)
+   {
+      return 0;
+   }
+
+   void packed_test(void)
+   {
+      std::string x, y;
+      for(int k = 0; k < 5; k++) {
+         x += "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+         y += "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+      }
+      y[70] = 'N', y[200] = 'N', x[3] = 'N';
+
+      // lower case comes back upper case and anything else as N
+      packed_sequence mixed(std::string("acgtRYNacgT"));
+      CU_ASSERT(std::string(mixed.begin(), mixed.end()) == "ACGTNNNACGT");
+      CU_ASSERT(mixed.code(4) == PACKED_N && mixed.code(10) == 3);
+
+      packed_sequence px(x), py(y), empty;
+      CU_ASSERT(std::string(px.begin(), px.end()) == x && std::string(py.begin(), py.end()) == y);
+      packed_sequence plain(x.substr(4));
+      CU_ASSERT(int_fast64_t(plain.bytes()) * 3 < plain.size() && plain.n_mask() == nullptr && empty.n_mask() == nullptr);
+
+      std::string backwards { std::reverse_iterator<packed_iterator>(py.end()), std::reverse_iterator<packed_iterator>(py.begin()) };
+      CU_ASSERT(backwards == std::string(y.rbegin(), y.rend()));
+
+      // the engines take the iterators
+      std::vector<std::string> expected(2, std::string()), result(2, std::string());
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected[0]), std::back_inserter(expected[1]),
+         scoring::plus_minus_one);
+      Hirschberg(px.begin(), px.end(), py.begin(), py.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+         scoring::plus_minus_one);
+      CU_ASSERT(result == expected);
+      CU_ASSERT(nwScore(px.begin(), px.end(), py.begin(), py.end(), scoring::plus_minus_one) ==
+         nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one));
+
+      // the kernels against the unpacked sequences, at sizes either side of the word boundaries
+      auto unit = [](const char &a, const char &b) -> int16_t { return a == b ? 0 : -1; };
+      for(int_fast64_t n : { 0, 1, 31, 32, 33, 63, 64, 65, 129, 300 }) {
+         for(int_fast64_t m : { 0, 1, 64, 65, 200, 390 }) {
+            std::string a = x.substr(0, n), b = y.substr(0, m);
+            packed_sequence pa(a), pb(b);
+            CU_ASSERT(packed_lcs_length(pa, pb) == lcs_length(a.begin(), a.end(), b.begin(), b.end()));
+            CU_ASSERT(packed_edit_distance(pa, pb) == -nwScore(a.begin(), a.end(), b.begin(), b.end(), unit).back());
+            CU_ASSERT(packed_edit_distance(pb, pa) == packed_edit_distance(pa, pb));
+         }
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // PACKED_HPP
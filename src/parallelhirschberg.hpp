@@ -0,0 +1,149 @@
+#ifndef PARALLELHIRSCHBERG_HPP
+#define PARALLELHIRSCHBERG_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "hirschberg.hpp"
+#include "taskpool.hpp"
+
+namespace stringAlgorithms {
+
+   // The output of one Hirschberg sub-problem
+   // a split sub-problem keeps its two halves in order, a solved one keeps its columns, writing the tree out
+   // in order gives the alignment no matter which order the halves finished in
+
+   template<typename T>
+   struct hirschberg_segment {
+      std::vector<T>                            w, z;
+      std::unique_ptr<hirschberg_segment<T>>    left, right;
+
+      template<typename BI>
+      void write(BI &w_back, BI &z_back) const {
+         if(left) {
+            left->write(w_back, z_back);
+            right->write(w_back, z_back);
+         } else {
+            w_back = std::copy(w.begin(), w.end(), w_back);
+            z_back = std::copy(z.begin(), z.end(), z_back);
+         }
+      }
+   };
+
+   template<typename I, typename F, typename P, typename T>
+   void parallel_hirschberg_step(task_pool &pool, I x_begin, I x_end, I y_begin, I y_end, F &score_function, P ID,
+      const T deleted_value, int_fast64_t grain, int_fast64_t cutoff, hirschberg_segment<T> &out)
+   {
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      // the serial Hirschberg makes the same split decisions below here so the alignment doesn't depend on grain
+      if(x_size <= 1 || y_size <= 1 || x_size * y_size <= grain || x_size * y_size <= cutoff) {
+         hirschberg_workspace<P, T> workspace(cutoff);
+         Hirschberg(x_begin, x_end, y_begin, y_end, std::back_inserter(out.w), std::back_inserter(out.z), score_function, workspace, ID,
+            deleted_value);
+         return;
+      }
+
+      auto x_mid = x_size / 2;
+
+      // the forward and reverse sweeps don't depend on each other
+
+      std::vector<P> ScoreL, ScoreR;
+      {
+         task_group sweeps(pool);
+         sweeps.run([&] { ScoreL = nwScore(x_begin, x_begin + x_mid, y_begin, y_end, score_function, ID); });
+         ScoreR = nwScore(std::reverse_iterator<I>(x_end), std::reverse_iterator<I>(x_begin + x_mid),
+            std::reverse_iterator<I>(y_end), std::reverse_iterator<I>(y_begin), score_function, ID);
+         sweeps.wait();
+      }
+
+      auto y_mid = partition(ScoreL.begin(), ScoreL.end(), ScoreR.begin(), ScoreR.end());
+
+      std::vector<P>().swap(ScoreL);
+      std::vector<P>().swap(ScoreR);
+
+      out.left.reset(new hirschberg_segment<T>);
+      out.right.reset(new hirschberg_segment<T>);
+
+      task_group halves(pool);
+      halves.run([&] {
+         parallel_hirschberg_step(pool, x_begin, x_begin + x_mid, y_begin, y_begin + y_mid, score_function, ID, deleted_value, grain, cutoff,
+            *out.left);
+      });
+      parallel_hirschberg_step(pool, x_begin + x_mid, x_end, y_begin + y_mid, y_end, score_function, ID, deleted_value, grain, cutoff,
+         *out.right);
+      halves.wait();
+   }
+
+   // Hirschberg with the forward and reverse sweeps of each split run at the same time and the two halves run as
+   // tasks on a work stealing pool of threads (threads = 0 uses every core). Sub-problems of grain cells or fewer
+   // are solved by the serial Hirschberg. The alignment is the same as Hirschberg's with the same cutoff.
+   // The score function is called from several threads at once.
+
+   template<typename I, typename BI, typename F>
+   void ParallelHirschberg(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back, F &&score_function, typename PP<F, I>::type ID = -1,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-', unsigned threads = 0, int_fast64_t grain = 1 << 18,
+      int_fast64_t cutoff = hirschberg_default_cutoff())
+   {
+      typedef typename std::iterator_traits<I>::value_type I_type;
+
+      task_pool pool(threads);
+      hirschberg_segment<I_type> result;
+
+      parallel_hirschberg_step(pool, x_begin, x_end, y_begin, y_end, score_function, ID, deleted_value, grain, cutoff, result);
+
+      result.write(w_back, z_back);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_parallel_hirschberg_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_parallel_hirschberg_suite(void)
+   {
+      return 0;
+   }
+
+   void parallel_hirschberg_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+
+      std::vector<std::string> expectedResult(2, std::string());
+      std::vector<std::string> result(2, std::string());
+
+      // a tiny grain and cutoff so the split goes several levels deep
+      hirschberg_workspace<int16_t, char> workspace(64);
+      Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expectedResult[0]), std::back_inserter(expectedResult[1]),
+         scoring::plus_minus_one, workspace);
+
+      ParallelHirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+         scoring::plus_minus_one, -1, '-', 4, 16, 64);
+
+      CU_ASSERT(result == expectedResult);
+      if(result != expectedResult) {
+         std::cout << std::endl;
+         std::cout << "result[0] = " << result[0] << std::endl;
+         std::cout << "result[1] = " << result[1] << std::endl;
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // PARALLELHIRSCHBERG_HPP
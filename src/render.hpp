@@ -0,0 +1,546 @@
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringoutput.hpp"
+#include "cigar.hpp"
+
+namespace stringAlgorithms {
+
+   // Rendering diffs
+   //
+   // display_diff copies its inputs, formats every element through a stringstream and wraps every differing element
+   // in its own pair of escapes. Here the output goes through one buffer that is handed to an ostream or a file
+   // descriptor when it fills, and a color is only written when it changes so a run of differences costs one escape
+   // pair. The alignment is read as columns, either from the padded form (a view given by iterators, nothing copied)
+   // or from a cigar and the two inputs, and can be laid out as the two lines display_diff prints, as a unified diff
+   // with hunks of context, or side by side with one column per line.
+
+   // A buffered sink for rendered text, the buffer is kept and reused until the writer goes away
+
+   class diff_writer {
+   public:
+      explicit diff_writer(std::ostream &os, bool color = true, size_t capacity = 1 << 16) :
+         os_(&os), fd_(-1), use_color_(color), buffer_(capacity), size_(0), current_(NORMAL), pending_(NORMAL), good_(true),
+         error_(0) {}
+
+      explicit diff_writer(int fd, bool color = true, size_t capacity = 1 << 16) :
+         os_(nullptr), fd_(fd), use_color_(color), buffer_(capacity), size_(0), current_(NORMAL), pending_(NORMAL), good_(true),
+         error_(0) {}
+
+      ~diff_writer() { flush(); }
+
+      diff_writer(const diff_writer &) = delete;
+      diff_writer &operator=(const diff_writer &) = delete;
+
+      // the color of what is written next, the escape is only written when a character goes out in a new color
+      void color(outputColors c) { pending_ = c; }
+
+      void put(char c) {
+         if(pending_ != current_) switch_color();
+         if(size_ == buffer_.size()) flush();
+         buffer_[size_++] = c;
+      }
+
+      void write(const char *s, size_t n) {
+         if(n == 0) return;
+         if(pending_ != current_) switch_color();
+         while(n > 0) {
+            if(size_ == buffer_.size()) flush();
+            size_t k = std::min(n, buffer_.size() - size_);
+            std::memcpy(buffer_.data() + size_, s, k);
+            size_ += k, s += k, n -= k;
+         }
+      }
+
+      void write(const char *s) { write(s, std::strlen(s)); }
+      void write(const std::string &s) { write(s.data(), s.size()); }
+
+      void write(int_fast64_t n) {
+         char digits[24];
+         int k = sizeof(digits);
+         uint64_t u = n < 0 ? 0 - uint64_t(n) : uint64_t(n);
+         do digits[--k] = '0' + u % 10; while(u /= 10);
+         if(n < 0) digits[--k] = '-';
+         write(digits + k, sizeof(digits) - k);
+      }
+
+      // hand the buffer to the stream or descriptor, false if this or an earlier write failed
+      // a write interrupted by a signal is retried, after a failure the rest of the output is dropped
+      bool flush() {
+         if(!good_) {
+            size_ = 0;
+            return false;
+         }
+         if(os_) {
+            os_->write(buffer_.data(), size_);
+            os_->flush();
+            if(!*os_) fail(EIO);
+         } else {
+            for(size_t done = 0; done < size_; ) {
+               ssize_t k = ::write(fd_, buffer_.data() + done, size_ - done);
+               if(k < 0 && errno == EINTR) continue;
+               if(k <= 0) {
+                  fail(k < 0 ? errno : EIO);
+                  break;
+               }
+               done += k;
+            }
+         }
+         size_ = 0;
+         return good_;
+      }
+
+      // false once a write has failed, error() is the errno of the first failure, EIO for a stream
+      bool good() const { return good_; }
+      int error() const { return error_; }
+
+   private:
+      void fail(int error) {
+         good_ = false;
+         error_ = error;
+      }
+
+      void switch_color() {
+         current_ = pending_;
+         if(!use_color_) return;
+         const char *escape = colorStrings[current_];
+         for(size_t n = std::strlen(escape); n > 0; n--) {
+            if(size_ == buffer_.size()) flush();
+            buffer_[size_++] = *escape++;
+         }
+      }
+
+      std::ostream         *os_;
+      int                  fd_;
+      bool                 use_color_;
+      std::vector<char>    buffer_;
+      size_t               size_;
+      outputColors         current_, pending_;
+      bool                 good_;
+      int                  error_;
+   };
+
+   // The text of one element, characters and strings as they are, integers in decimal, anything else with operator<<
+
+   inline void append_element(std::string &text, char c) { text.push_back(c); }
+   inline void append_element(std::string &text, const std::string &s) { text += s; }
+
+   template<typename T>
+   typename std::enable_if<std::is_integral<T>::value>::type
+   append_element(std::string &text, const T &n) {
+      text += std::to_string(n);
+   }
+
+   template<typename T>
+   typename std::enable_if<!std::is_integral<T>::value>::type
+   append_element(std::string &text, const T &t) {
+      std::ostringstream os;
+      os << t;
+      text += os.str();
+   }
+
+   inline void write_element(diff_writer &out, char c, std::string &) { out.put(c); }
+   inline void write_element(diff_writer &out, const std::string &s, std::string &) { out.write(s); }
+
+   template<typename T>
+   void write_element(diff_writer &out, const T &t, std::string &scratch) {
+      scratch.clear();
+      append_element(scratch, t);
+      out.write(scratch);
+   }
+
+   // One column of an alignment, x and y point at its elements, x isn't an element of x for CIGAR_INSERT and y isn't
+   // one of y for CIGAR_DELETE
+
+   template<typename I>
+   struct diff_column {
+      cigar_code  code;
+      I           x, y;
+   };
+
+   // The columns of the padded form, w and z are read in place
+
+   template<typename I>
+   class padded_columns {
+   public:
+      typedef I                                             iterator;
+      typedef typename std::iterator_traits<I>::value_type  value_type;
+
+      padded_columns(I w_begin, I w_end, I z_begin, const value_type deleted_value = '-') :
+         w_(w_begin), w_end_(w_end), z_(z_begin), deleted_value_(deleted_value) {}
+
+      bool next(diff_column<I> &column) {
+         if(w_ == w_end_) return false;
+         column.x = w_;
+         column.y = z_;
+         if(*w_ == deleted_value_) column.code = CIGAR_INSERT;
+         else if(*z_ == deleted_value_) column.code = CIGAR_DELETE;
+         else column.code = *w_ == *z_ ? CIGAR_EQUAL : CIGAR_MISMATCH;
+         ++w_, ++z_;
+         return true;
+      }
+
+   private:
+      I           w_, w_end_, z_;
+      value_type  deleted_value_;
+   };
+
+   // The columns of a cigar over x and y, the script must outlive the columns
+
+   template<typename I>
+   class script_columns {
+   public:
+      typedef I                                             iterator;
+      typedef typename std::iterator_traits<I>::value_type  value_type;
+
+      script_columns(const cigar &script, I x_begin, I y_begin) :
+         op_(script.data()), op_end_(script.data() + script.size()), left_(0), code_(CIGAR_EQUAL), x_(x_begin), y_(y_begin) {}
+
+      bool next(diff_column<I> &column) {
+         while(left_ == 0) {
+            if(op_ == op_end_) return false;
+            left_ = op_->length();
+            code_ = op_->code();
+            op_++;
+         }
+         // an M run from SAM says match or mismatch, the elements say which
+         column.code = code_ == CIGAR_MATCH ? (*x_ == *y_ ? CIGAR_EQUAL : CIGAR_MISMATCH) : code_;
+         column.x = x_;
+         column.y = y_;
+         if(code_ != CIGAR_INSERT) ++x_;
+         if(code_ != CIGAR_DELETE) ++y_;
+         left_--;
+         return true;
+      }
+
+   private:
+      const cigar_op *op_, *op_end_;
+      uint32_t       left_;
+      cigar_code     code_;
+      I              x_, y_;
+   };
+
+   template<typename I>
+   padded_columns<I> make_padded_columns(I w_begin, I w_end, I z_begin, const typename std::iterator_traits<I>::value_type deleted_value = '-')
+   {
+      return padded_columns<I>(w_begin, w_end, z_begin, deleted_value);
+   }
+
+   template<typename I>
+   script_columns<I> make_script_columns(const cigar &script, I x_begin, I y_begin)
+   {
+      return script_columns<I>(script, x_begin, y_begin);
+   }
+
+   inline outputColors diff_color(cigar_code code) {
+      return code == CIGAR_EQUAL ? NORMAL : code == CIGAR_MISMATCH ? RED : CYAN;
+   }
+
+   // Two lines as display_diff prints them, a = x and b = y with gaps, substitutions red and indels cyan. Characters
+   // are run together, other elements are listed in brackets.
+
+   template<typename C>
+   void render_plain(diff_writer &out, C columns, char gap = '-')
+   {
+      typedef typename C::iterator     I;
+      typedef typename C::value_type   T;
+
+      const bool list = !std::is_same<T, char>::value;
+      std::string scratch;
+      diff_column<I> column;
+
+      for(int side = 0; side < 2; side++) {
+         C cur = columns;
+         out.write(side == 0 ? "a = " : "b = ");
+         if(list) out.write("[ ");
+         for(bool first = true; cur.next(column); first = false) {
+            if(list && !first) out.write(", ");
+            bool present = side == 0 ? column.code != CIGAR_INSERT : column.code != CIGAR_DELETE;
+            if(present) {
+               out.color(diff_color(column.code));
+               write_element(out, side == 0 ? *column.x : *column.y, scratch);
+            } else {
+               out.color(NORMAL);
+               out.put(gap);
+            }
+         }
+         out.color(NORMAL);
+         if(list) out.write(" ]");
+         out.put('\n');
+      }
+   }
+
+   // A unified diff, one element to a line, with context elements around each change and a header for each hunk.
+   // Nothing is written for inputs that are the same, the --- and +++ lines are left to the caller.
+
+   template<typename C>
+   void render_unified(diff_writer &out, C columns, int_fast64_t context = 3)
+   {
+      typedef typename C::iterator I;
+
+      // the runs of changed columns, then the hunks around them
+      std::vector<std::pair<int_fast64_t, int_fast64_t>> hunks;
+      diff_column<I> column;
+      int_fast64_t total = 0;
+      for(C cur = columns; cur.next(column); total++) {
+         if(column.code == CIGAR_EQUAL) continue;
+         if(!hunks.empty() && hunks.back().second + 2 * context >= total) hunks.back().second = total + 1;
+         else hunks.push_back(std::make_pair(total, total + 1));
+      }
+
+      std::string scratch;
+      C cur = columns;
+      int_fast64_t index = 0, x_line = 1, y_line = 1;
+
+      auto skip = [&](int_fast64_t to) {
+         for(; index < to && cur.next(column); index++) {
+            if(column.code != CIGAR_INSERT) x_line++;
+            if(column.code != CIGAR_DELETE) y_line++;
+         }
+      };
+
+      for(auto &hunk : hunks) {
+         int_fast64_t begin = std::max<int_fast64_t>(0, hunk.first - context), end = std::min(total, hunk.second + context);
+         skip(begin);
+
+         int_fast64_t x_count = 0, y_count = 0;
+         C count = cur;
+         for(int_fast64_t k = begin; k < end && count.next(column); k++) {
+            if(column.code != CIGAR_INSERT) x_count++;
+            if(column.code != CIGAR_DELETE) y_count++;
+         }
+
+         out.color(CYAN);
+         out.write("@@ -");
+         out.write(x_count == 0 ? x_line - 1 : x_line);
+         out.put(',');
+         out.write(x_count);
+         out.write(" +");
+         out.write(y_count == 0 ? y_line - 1 : y_line);
+         out.put(',');
+         out.write(y_count);
+         out.write(" @@");
+         out.color(NORMAL);
+         out.put('\n');
+
+         while(index < end) {
+            C change = cur;
+            if(!change.next(column)) break;
+            if(column.code == CIGAR_EQUAL) {
+               out.put(' ');
+               write_element(out, *column.x, scratch);
+               out.put('\n');
+               skip(index + 1);
+               continue;
+            }
+
+            // a run of changes is written as all of its x lines then all of its y lines
+            int_fast64_t run = 1;
+            for(C ahead = change; ahead.next(column) && column.code != CIGAR_EQUAL && index + run < end; ) run++;
+            for(int side = 0; side < 2; side++) {
+               C walk = cur;
+               out.color(side == 0 ? RED : GREEN);
+               for(int_fast64_t k = 0; k < run && walk.next(column); k++) {
+                  if(column.code == (side == 0 ? CIGAR_INSERT : CIGAR_DELETE)) continue;
+                  out.put(side == 0 ? '-' : '+');
+                  write_element(out, side == 0 ? *column.x : *column.y, scratch);
+                  out.put('\n');
+               }
+            }
+            out.color(NORMAL);
+            skip(index + run);
+         }
+      }
+   }
+
+   // x on the left and y on the right, one column to a line, the left side padded or cut to width characters, marked
+   // between the sides the way diff -y does: | a substitution, < a deletion and > an insertion
+
+   template<typename C>
+   void render_side_by_side(diff_writer &out, C columns, int_fast64_t width = 40)
+   {
+      typedef typename C::iterator I;
+
+      std::string text;
+      diff_column<I> column;
+      for(C cur = columns; cur.next(column); ) {
+         outputColors color = diff_color(column.code);
+
+         text.clear();
+         if(column.code != CIGAR_INSERT) append_element(text, *column.x);
+         if((int_fast64_t)text.size() > width) text.resize(width);
+         out.color(color);
+         out.write(text);
+         out.color(NORMAL);
+         for(int_fast64_t k = text.size(); k < width; k++) out.put(' ');
+
+         switch(column.code) {
+            case CIGAR_EQUAL: out.write("   "); break;
+            case CIGAR_MISMATCH: out.write(" | "); break;
+            case CIGAR_DELETE: out.write(" <"); break;
+            default: out.write(" > "); break;
+         }
+
+         if(column.code != CIGAR_DELETE) {
+            text.clear();
+            append_element(text, *column.y);
+            out.color(color);
+            out.write(text);
+            out.color(NORMAL);
+         }
+         out.put('\n');
+      }
+   }
+
+   enum diff_layout { DIFF_PLAIN, DIFF_UNIFIED, DIFF_SIDE_BY_SIDE };
+
+   // Any of the layouts with their defaults
+
+   template<typename C>
+   void render_diff(diff_writer &out, C columns, diff_layout layout = DIFF_PLAIN)
+   {
+      switch(layout) {
+         case DIFF_PLAIN: render_plain(out, columns); break;
+         case DIFF_UNIFIED: render_unified(out, columns); break;
+         case DIFF_SIDE_BY_SIDE: render_side_by_side(out, columns); break;
+      }
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_render_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_render_suite(void)
+   {
+      return 0;
+   }
+
+   void render_test(void)
+   {
+      std::string w = "GAAXXXTT-CA";
+      std::string z = "GAAYYYTTGC-";
+
+      // runs of the same color share one pair of escapes
+      std::ostringstream os;
+      {
+         diff_writer out(os);
+         render_plain(out, make_padded_columns(w.begin(), w.end(), z.begin()));
+      }
+      std::string expected =
+         "a = GAA\033[31mXXX\033[0mTT-C\033[36mA\033[0m\n"
+         "b = GAA\033[31mYYY\033[0mTT\033[36mG\033[0mC-\n";
+      CU_ASSERT(os.str() == expected);
+      if(os.str() != expected) std::cout << std::endl << os.str() << std::endl;
+
+      // the same from a cigar without colors, and a buffer small enough to be flushed part way
+      std::string x = "GAAXXXTTCA", y = "GAAYYYTTGC";
+      cigar script = cigar_from_alignment(w.begin(), w.end(), z.begin());
+      os.str("");
+      {
+         diff_writer out(os, false, 5);
+         render_plain(out, make_script_columns(script, x.begin(), y.begin()));
+      }
+      CU_ASSERT(os.str() == "a = GAAXXXTT-CA\nb = GAAYYYTTGC-\n");
+
+      // integers are listed
+      std::vector<uint64_t> a = { 1, 2, 3, 4, 5 }, b = { 1, 2, 0, 5 };
+      script = NeedlemanWunschCigar(a.begin(), a.end(), b.begin(), b.end(), scoring::plus_minus_one);
+      os.str("");
+      {
+         diff_writer out(os, false);
+         render_plain(out, make_script_columns(script, a.begin(), b.begin()));
+      }
+      CU_ASSERT(os.str() == "a = [ 1, 2, 3, 4, 5 ]\nb = [ 1, 2, -, 0, 5 ]\n");
+
+      // lines, with one line of context, two changes close enough to share a hunk and one on its own
+      std::vector<std::string> before = { "a", "b", "c", "d", "e", "f", "g", "h", "i", "j" };
+      std::vector<std::string> after = { "a", "B", "c", "e", "f", "g", "h", "i", "j", "k" };
+      script = HirschbergCigar(before.begin(), before.end(), after.begin(), after.end(),
+         [](const std::string &p, const std::string &q) -> int16_t { return p == q ? 1 : -1; });
+      os.str("");
+      {
+         diff_writer out(os, false);
+         render_unified(out, make_script_columns(script, before.begin(), after.begin()), 1);
+      }
+      expected =
+         "@@ -1,5 +1,4 @@\n"
+         " a\n"
+         "-b\n"
+         "+B\n"
+         " c\n"
+         "-d\n"
+         " e\n"
+         "@@ -10,1 +9,2 @@\n"
+         " j\n"
+         "+k\n";
+      CU_ASSERT(os.str() == expected);
+      if(os.str() != expected) std::cout << std::endl << os.str() << std::endl;
+
+      os.str("");
+      {
+         diff_writer out(os, false);
+         render_side_by_side(out, make_script_columns(script, before.begin(), after.begin()), 3);
+      }
+      expected = "a     a\nb   | B\nc     c\nd   <\ne     e\nf     f\ng     g\nh     h\ni     i\nj     j\n    > k\n";
+      CU_ASSERT(os.str() == expected);
+      if(os.str() != expected) std::cout << std::endl << os.str() << std::endl;
+
+      // nothing to show for the same input
+      std::string same = "ACGT";
+      os.str("");
+      {
+         diff_writer out(os);
+         render_unified(out, make_padded_columns(same.begin(), same.end(), same.begin()));
+      }
+      CU_ASSERT(os.str().empty());
+
+      // a descriptor, then failures are kept rather than dropped without a word
+      int fds[2];
+      CU_ASSERT(pipe(fds) == 0);
+      {
+         diff_writer out(fds[1], false, 4);
+         out.write("GATTACA");
+         CU_ASSERT(out.flush() && out.good());
+      }
+      char read_back[8] = { 0 };
+      CU_ASSERT(read(fds[0], read_back, 7) == 7 && std::string(read_back) == "GATTACA");
+      close(fds[0]);
+      close(fds[1]);
+
+      diff_writer bad_fd(-1, false, 4);
+      bad_fd.write("GATTACA");
+      CU_ASSERT(!bad_fd.flush() && !bad_fd.good() && bad_fd.error() == EBADF);
+
+      std::ostringstream failed;
+      failed.setstate(std::ios::badbit);
+      diff_writer bad_stream(failed, false);
+      bad_stream.put('A');
+      CU_ASSERT(!bad_stream.flush() && bad_stream.error() == EIO);
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // RENDER_HPP
@@ -0,0 +1,313 @@
+#ifndef SCORE_HPP
+#define SCORE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "hirschberg.hpp"
+#include "nwrow.hpp"
+
+namespace stringAlgorithms {
+
+   // Score-only Needleman-Wunsch
+   //
+   // When only the score is wanted there's no traceback and only two rows are kept. alignment_score_reaches() can
+   // also give up part way: after row i the best any path through (i, j) can finish with is row[j] plus the best
+   // the rest of the matrix could score, min(x_left, y_left) matches of max_match_score() and |x_left - y_left|
+   // gaps (or all gaps if that is better), so once no cell of a row can reach the threshold the answer is known.
+   // alignment_score_xdrop() is the heuristic version, it drops any cell more than xdrop below the best cell seen.
+
+   // The Needleman-Wunsch score of x and y
+
+   template<typename I, typename F>
+   typename PP<F, I>::type alignment_score(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1)
+   {
+      typedef typename PP<F, I>::type P;
+
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      std::vector<P> top(y_size + 1), bottom(y_size + 1);
+      return nw_score_row(x_begin, x_end, y_begin, y_end, score_function, ID, top.data(), bottom.data())[y_size];
+   }
+
+   // Whether the Needleman-Wunsch score of x and y is at least threshold, stopping as soon as it can't be
+   // the rows are checked every check_rows rows since the check costs about as much as a row
+
+   template<typename I, typename F>
+   bool alignment_score_reaches(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type threshold,
+      typename PP<F, I>::type ID = -1, int_fast64_t check_rows = 8)
+   {
+      typedef typename PP<F, I>::type                          P;
+      typedef typename std::common_type<P, int_fast64_t>::type W;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      W match = max_match_score(x_begin, x_end, y_begin, y_end, score_function);
+
+      // the best the rest of the matrix can add from a cell with x_left and y_left still to go
+      auto rest = [&](int_fast64_t x_left, int_fast64_t y_left) -> W {
+         return std::max(std::min(x_left, y_left) * match + std::abs(x_left - y_left) * W(ID), (x_left + y_left) * W(ID));
+      };
+
+      std::vector<P> top(y_size + 1), bottom(y_size + 1);
+      P *top_row = top.data(), *bottom_row = bottom.data();
+
+      nw_row_sweep<I, F> sweep(y_begin, y_end, score_function, ID);
+
+      sweep.first_row(top_row);
+      int_fast64_t i = 0;
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++) {
+         sweep(*x_cur, top_row, bottom_row);
+         std::swap(top_row, bottom_row);
+         i++;
+
+         if(check_rows > 0 && i % check_rows == 0 && i < x_size) {
+            bool reachable = false;
+            for(int_fast64_t j = 0; j <= y_size && !reachable; j++) reachable = top_row[j] + rest(x_size - i, y_size - j) >= W(threshold);
+            if(!reachable) return false;
+         }
+      }
+      return top_row[y_size] >= threshold;
+   }
+
+   // The Needleman-Wunsch score of x and y leaving out every cell which scores more than xdrop below the best cell
+   // seen so far. Returns false if every cell of a row was dropped or the last cell was, otherwise score is set to
+   // the best score through the cells that were kept. This is a heuristic, a path which dips more than xdrop below
+   // the best can be missed.
+
+   template<typename I, typename F>
+   bool alignment_score_xdrop(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type xdrop,
+      typename PP<F, I>::type &score, typename PP<F, I>::type ID = -1)
+   {
+      typedef typename PP<F, I>::type P;
+
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      // a dropped cell, only [lo, hi] of the row above is kept
+      const P dropped = std::numeric_limits<P>::lowest();
+
+      std::vector<P> top(y_size + 1, dropped), bottom(y_size + 1, dropped);
+
+      P              best = 0;
+      int_fast64_t   lo = 0, hi = 0;
+
+      top[0] = 0;
+      for(int_fast64_t j = 1; j <= y_size && top[j-1] + ID >= best - xdrop; j++, hi++) top[j] = top[j-1] + ID;
+
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++) {
+         int_fast64_t next_lo = -1, next_hi = -1;
+
+         auto y_cur = std::next(y_begin, std::max<int_fast64_t>(lo - 1, 0));
+         for(int_fast64_t j = lo; j <= y_size; j++) {
+            P cell = dropped;
+            if(j > lo && j - 1 <= hi && top[j-1] != dropped) cell = top[j-1] + score_function(*x_cur, *y_cur);
+            if(j <= hi && top[j] != dropped) cell = std::max<P>(cell, top[j] + ID);
+            if(j > lo && bottom[j-1] != dropped) cell = std::max<P>(cell, bottom[j-1] + ID);
+
+            if(cell != dropped && cell >= best - xdrop) {
+               best = std::max(best, cell);
+               if(next_lo < 0) next_lo = j;
+               next_hi = j;
+            } else {
+               cell = dropped;
+            }
+            bottom[j] = cell;
+
+            // past the row above only moves from the left are possible
+            if(j > hi && cell == dropped) break;
+            if(j > 0) y_cur++;
+         }
+         if(next_lo < 0) return false;
+
+         lo = next_lo;
+         hi = next_hi;
+         std::swap(top, bottom);
+      }
+
+      if(hi != y_size) return false;
+      score = top[y_size];
+      return true;
+   }
+
+#if STRINGALGORITHMS_SIMD
+
+   // The score of x and y in lanes of V, false if a cell saturated and the score can't be trusted
+
+   template<typename V, typename I, typename F>
+   bool simd_alignment_score(I x_begin, I x_end, I y_begin, I y_end, F &score_function, typename V::value_type ID, int_fast64_t &score)
+   {
+      typedef typename V::value_type P;
+
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      std::vector<P> top(y_size + 1), bottom(y_size + 1);
+      P *top_row = top.data(), *bottom_row = bottom.data();
+
+      nw_simd_row_sweep<I, F, V> sweep(y_begin, y_end, score_function, ID);
+
+      sweep.first_row(top_row);
+      for(auto x_cur = x_begin; x_cur != x_end; x_cur++) {
+         sweep(*x_cur, top_row, bottom_row);
+         std::swap(top_row, bottom_row);
+      }
+      score = top_row[y_size];
+      return !sweep.saturated();
+   }
+
+   // Whether every score of the symbols in x and y and the gap constants of V fit in V::value_type
+
+   template<typename V>
+   bool simd_scores_fit(int_fast64_t low, int_fast64_t high, int_fast64_t ID) {
+      typedef typename V::value_type P;
+      return low >= std::numeric_limits<P>::min() && high <= std::numeric_limits<P>::max()
+         && std::abs(ID) * V::lanes <= std::numeric_limits<P>::max();
+   }
+
+#endif // STRINGALGORITHMS_SIMD
+
+   // The Needleman-Wunsch score of x and y without having to pick a score type wide enough for it
+   //
+   // Byte elements are first scored in saturating int8 lanes, twice as many as int16, and if any cell saturates
+   // the score is worked out again in int16 lanes and then in int32 (int64 if the scores could get that large or
+   // the elements aren't bytes).
+   // Short similar sequences, whose scores stay within +-127, never leave the first pass. bits, if given, is set to
+   // the width that gave the score.
+
+   template<typename I, typename F>
+   int_fast64_t adaptive_alignment_score(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, int_fast64_t ID = -1,
+      int *bits = nullptr)
+   {
+      typedef typename std::iterator_traits<I>::value_type I_type;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      // the range of score(a, b) over the byte symbols which turn up
+      int_fast64_t low = 0, high = 0;
+      bool bytes = sizeof(I_type) == 1 && std::is_integral<I_type>::value;
+      if(bytes) {
+         bool     seen_x[256] = {}, seen_y[256] = {};
+         I_type   symbols_x[256], symbols_y[256];
+         int      x_symbols = 0, y_symbols = 0;
+         for(auto x_cur = x_begin; x_cur != x_end; x_cur++) {
+            auto c = static_cast<unsigned char>(*x_cur);
+            if(!seen_x[c]) seen_x[c] = true, symbols_x[x_symbols++] = *x_cur;
+         }
+         for(auto y_cur = y_begin; y_cur != y_end; y_cur++) {
+            auto c = static_cast<unsigned char>(*y_cur);
+            if(!seen_y[c]) seen_y[c] = true, symbols_y[y_symbols++] = *y_cur;
+         }
+         for(int a = 0; a < x_symbols; a++) {
+            for(int b = 0; b < y_symbols; b++) {
+               int_fast64_t s = score_function(symbols_x[a], symbols_y[b]);
+               low = std::min(low, s);
+               high = std::max(high, s);
+            }
+         }
+      }
+
+#if STRINGALGORITHMS_SIMD
+      if(bytes) {
+         int_fast64_t score;
+         if(simd_scores_fit<simd::i8>(low, high, ID)
+            && simd_alignment_score<simd::i8>(x_begin, x_end, y_begin, y_end, score_function, ID, score)) {
+            if(bits) *bits = 8;
+            return score;
+         }
+         if(simd_scores_fit<simd::i16>(low, high, ID)
+            && simd_alignment_score<simd::i16>(x_begin, x_end, y_begin, y_end, score_function, ID, score)) {
+            if(bits) *bits = 16;
+            return score;
+         }
+      }
+#endif
+
+      // no cell can be further from 0 than one step of the largest size per element, other elements aren't
+      // scanned for their range so they go straight to int64
+      int_fast64_t step = std::max({std::abs(low), std::abs(high), std::abs(ID)});
+      if(bytes && step * (x_size + y_size) <= INT32_MAX) {
+         if(bits) *bits = 32;
+         auto wide = [&](const I_type &a, const I_type &b) -> int32_t { return score_function(a, b); };
+         return alignment_score(x_begin, x_end, y_begin, y_end, wide, int32_t(ID));
+      }
+      if(bits) *bits = 64;
+      auto wide = [&](const I_type &a, const I_type &b) -> int64_t { return score_function(a, b); };
+      return alignment_score(x_begin, x_end, y_begin, y_end, wide, int64_t(ID));
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_score_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_score_suite(void)
+   {
+      return 0;
+   }
+
+   void score_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+      std::string z = "CGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCGCG";
+
+      auto three_two = [](const char &a, const char &b) -> int16_t { return a == b ? 3 : -2; };
+
+      int16_t expected = nwScore(x.begin(), x.end(), y.begin(), y.end(), three_two, -3).back();
+      CU_ASSERT(alignment_score(x.begin(), x.end(), y.begin(), y.end(), three_two, -3) == expected);
+
+      CU_ASSERT(alignment_score_reaches(x.begin(), x.end(), y.begin(), y.end(), three_two, expected, -3));
+      CU_ASSERT(!alignment_score_reaches(x.begin(), x.end(), y.begin(), y.end(), three_two, expected + 1, -3));
+      CU_ASSERT(!alignment_score_reaches(x.begin(), x.end(), z.begin(), z.end(), three_two, 100, -3, 1));
+
+      // with a wide enough drop nothing on the best path is dropped
+      int16_t score = 0;
+      CU_ASSERT(alignment_score_xdrop(x.begin(), x.end(), y.begin(), y.end(), three_two, 1000, score, -3) && score == expected);
+      CU_ASSERT(!alignment_score_xdrop(x.begin(), x.end(), z.begin(), z.end(), three_two, 10, score, -3));
+      return;
+   }
+
+   void adaptive_score_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCC";
+      int         bits = 0;
+
+      // short enough for int8 lanes
+      int_fast64_t expected = nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one).back();
+      CU_ASSERT(adaptive_alignment_score(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one, -1, &bits) == expected);
+      CU_ASSERT(bits == (STRINGALGORITHMS_SIMD ? 8 : 32));
+
+      // the edges of the matrix saturate int8 and the score itself doesn't fit in int16
+      for(int k = 0; k < 6; k++) x += x, y += y;
+      auto big = [](const char &a, const char &b) -> int32_t { return a == b ? 300 : -200; };
+      auto wide = [](const char &a, const char &b) -> int64_t { return a == b ? 300 : -200; };
+      expected = alignment_score(x.begin(), x.end(), y.begin(), y.end(), wide, -2);
+      CU_ASSERT(adaptive_alignment_score(x.begin(), x.end(), y.begin(), y.end(), big, -2, &bits) == expected);
+      CU_ASSERT(bits == 32);
+
+      expected = nwScore(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one).back();
+      CU_ASSERT(adaptive_alignment_score(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one, -1, &bits) == expected);
+      CU_ASSERT(bits == (STRINGALGORITHMS_SIMD ? 16 : 32));
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // SCORE_HPP
@@ -0,0 +1,282 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Define STRINGALGORITHMS_NO_SIMD to force the scalar code paths
+
+#if !defined(STRINGALGORITHMS_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define STRINGALGORITHMS_SIMD 1
+#elif !defined(STRINGALGORITHMS_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define STRINGALGORITHMS_SIMD 1
+#else
+#define STRINGALGORITHMS_SIMD 0
+#endif
+
+namespace stringAlgorithms {
+
+   namespace simd {
+
+      // saturate an int into the range of int16_t, used when building lane constants like k * ID
+
+      inline int16_t saturate16(int_fast64_t x) {
+         return x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : static_cast<int16_t>(x));
+      }
+
+      template<typename T>
+      T saturate(int_fast64_t x) {
+         return x > std::numeric_limits<T>::max() ? std::numeric_limits<T>::max() :
+            (x < std::numeric_limits<T>::min() ? std::numeric_limits<T>::min() : static_cast<T>(x));
+      }
+
+#if STRINGALGORITHMS_SIMD
+
+      // 16 bit signed lanes with saturating arithmetic
+      // shift_up<k>() moves every lane up k places and fills the bottom k lanes with INT16_MIN
+      // prefix_max() takes gap_steps gaps, the gaps of 1, 2, 4, ... lanes
+      //
+      // i8 is the same with 8 bit lanes, twice as many to a vector
+
+#if defined(__AVX2__)
+
+      struct i16 {
+         typedef __m256i   type;
+         typedef int16_t   value_type;
+         static const int  lanes = 16;
+         static const int  gap_steps = 4;
+
+         static type load(const int16_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+         static void store(int16_t *p, type v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+         static type set1(int16_t x) { return _mm256_set1_epi16(x); }
+         static type adds(type a, type b) { return _mm256_adds_epi16(a, b); }
+         static type max(type a, type b) { return _mm256_max_epi16(a, b); }
+         static type min(type a, type b) { return _mm256_min_epi16(a, b); }
+         static type cmpeq(type a, type b) { return _mm256_cmpeq_epi16(a, b); }
+         static type bit_and(type a, type b) { return _mm256_and_si256(a, b); }
+         static type bit_or(type a, type b) { return _mm256_or_si256(a, b); }
+         static type bit_andnot(type a, type b) { return _mm256_andnot_si256(a, b); }
+
+         // lanes holding 0..3 packed 2 bits each into lanes / 4 bytes, lane 0 in the low bits of out[0]
+         static void pack_2bit(type v, uint8_t *out) {
+            v = _mm256_or_si256(v, _mm256_srli_epi32(v, 14));
+            v = _mm256_or_si256(v, _mm256_srli_epi64(v, 28));
+            alignas(32) uint8_t bytes[32];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(bytes), v);
+            out[0] = bytes[0]; out[1] = bytes[8]; out[2] = bytes[16]; out[3] = bytes[24];
+         }
+
+         template<int k>
+         static type shift_up(type v) {
+            type low = _mm256_permute2x128_si256(v, v, 0x08);
+            return _mm256_or_si256(_mm256_alignr_epi8(v, low, 16 - 2 * k), fill(k));
+         }
+
+         // max over lanes k <= l of v[k] + (l - k) * gap, gap[s] holds s * gap for s = 1, 2, 4, 8
+         static type prefix_max(type v, const type *gap) {
+            v = max(v, adds(shift_up<1>(v), gap[0]));
+            v = max(v, adds(shift_up<2>(v), gap[1]));
+            v = max(v, adds(shift_up<4>(v), gap[2]));
+            v = max(v, adds(shift_up<8>(v), gap[3]));
+            return v;
+         }
+
+         static type fill(int k) {
+            static const int16_t mask[32] = {
+               INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN,
+               INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN,
+               0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+            };
+            return load(mask + 16 - k);
+         }
+      };
+
+      struct i8 {
+         typedef __m256i   type;
+         typedef int8_t    value_type;
+         static const int  lanes = 32;
+         static const int  gap_steps = 5;
+
+         static type load(const int8_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+         static void store(int8_t *p, type v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+         static type set1(int8_t x) { return _mm256_set1_epi8(x); }
+         static type adds(type a, type b) { return _mm256_adds_epi8(a, b); }
+         static type max(type a, type b) { return _mm256_max_epi8(a, b); }
+         static type min(type a, type b) { return _mm256_min_epi8(a, b); }
+
+         template<int k>
+         static type shift_up(type v) {
+            type low = _mm256_permute2x128_si256(v, v, 0x08);
+            return _mm256_or_si256(_mm256_alignr_epi8(v, low, 16 - k), fill(k));
+         }
+
+         static type prefix_max(type v, const type *gap) {
+            v = max(v, adds(shift_up<1>(v), gap[0]));
+            v = max(v, adds(shift_up<2>(v), gap[1]));
+            v = max(v, adds(shift_up<4>(v), gap[2]));
+            v = max(v, adds(shift_up<8>(v), gap[3]));
+            v = max(v, adds(shift_up<16>(v), gap[4]));
+            return v;
+         }
+
+         static type fill(int k) {
+            static const int8_t mask[64] = {
+               INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN,
+               INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN,
+               INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN,
+               INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN
+            };
+            return load(mask + 32 - k);
+         }
+      };
+
+#else
+
+      struct i16 {
+         typedef __m128i   type;
+         typedef int16_t   value_type;
+         static const int  lanes = 8;
+         static const int  gap_steps = 3;
+
+         static type load(const int16_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+         static void store(int16_t *p, type v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+         static type set1(int16_t x) { return _mm_set1_epi16(x); }
+         static type adds(type a, type b) { return _mm_adds_epi16(a, b); }
+         static type max(type a, type b) { return _mm_max_epi16(a, b); }
+         static type min(type a, type b) { return _mm_min_epi16(a, b); }
+         static type cmpeq(type a, type b) { return _mm_cmpeq_epi16(a, b); }
+         static type bit_and(type a, type b) { return _mm_and_si128(a, b); }
+         static type bit_or(type a, type b) { return _mm_or_si128(a, b); }
+         static type bit_andnot(type a, type b) { return _mm_andnot_si128(a, b); }
+
+         // lanes holding 0..3 packed 2 bits each into lanes / 4 bytes, lane 0 in the low bits of out[0]
+         static void pack_2bit(type v, uint8_t *out) {
+            v = _mm_or_si128(v, _mm_srli_epi32(v, 14));
+            v = _mm_or_si128(v, _mm_srli_epi64(v, 28));
+            out[0] = static_cast<uint8_t>(_mm_cvtsi128_si32(v));
+            out[1] = static_cast<uint8_t>(_mm_extract_epi16(v, 4));
+         }
+
+         template<int k>
+         static type shift_up(type v) {
+            return _mm_or_si128(_mm_slli_si128(v, 2 * k), fill(k));
+         }
+
+         // max over lanes k <= l of v[k] + (l - k) * gap, gap[s] holds s * gap for s = 1, 2, 4
+         static type prefix_max(type v, const type *gap) {
+            v = max(v, adds(shift_up<1>(v), gap[0]));
+            v = max(v, adds(shift_up<2>(v), gap[1]));
+            v = max(v, adds(shift_up<4>(v), gap[2]));
+            return v;
+         }
+
+         static type fill(int k) {
+            static const int16_t mask[16] = {
+               INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN,
+               0, 0, 0, 0, 0, 0, 0, 0
+            };
+            return load(mask + 8 - k);
+         }
+      };
+
+      struct i8 {
+         typedef __m128i   type;
+         typedef int8_t    value_type;
+         static const int  lanes = 16;
+         static const int  gap_steps = 4;
+
+         static type load(const int8_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+         static void store(int8_t *p, type v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+         static type set1(int8_t x) { return _mm_set1_epi8(x); }
+         static type adds(type a, type b) { return _mm_adds_epi8(a, b); }
+
+         // SSE2 only has unsigned byte max and min, flipping the sign bits maps the signed order onto the unsigned
+         static type max(type a, type b) {
+            const type sign = _mm_set1_epi8(INT8_MIN);
+            return _mm_xor_si128(_mm_max_epu8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)), sign);
+         }
+         static type min(type a, type b) {
+            const type sign = _mm_set1_epi8(INT8_MIN);
+            return _mm_xor_si128(_mm_min_epu8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)), sign);
+         }
+
+         template<int k>
+         static type shift_up(type v) {
+            return _mm_or_si128(_mm_slli_si128(v, k), fill(k));
+         }
+
+         static type prefix_max(type v, const type *gap) {
+            v = max(v, adds(shift_up<1>(v), gap[0]));
+            v = max(v, adds(shift_up<2>(v), gap[1]));
+            v = max(v, adds(shift_up<4>(v), gap[2]));
+            v = max(v, adds(shift_up<8>(v), gap[3]));
+            return v;
+         }
+
+         static type fill(int k) {
+            static const int8_t mask[32] = {
+               INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN,
+               INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN, INT8_MIN
+            };
+            return load(mask + 16 - k);
+         }
+      };
+
+#endif // __AVX2__
+
+#endif // STRINGALGORITHMS_SIMD
+
+      // The number of equal bytes at the start of a and b, n if all of them are, compared a vector at a time
+
+      inline size_t mismatch_bytes(const uint8_t *a, const uint8_t *b, size_t n) {
+         size_t i = 0;
+#if STRINGALGORITHMS_SIMD && defined(__AVX2__)
+         for(; i + 32 <= n; i += 32) {
+            __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+               _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+            uint32_t differ = ~static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+            if(differ) return i + __builtin_ctz(differ);
+         }
+#elif STRINGALGORITHMS_SIMD
+         for(; i + 16 <= n; i += 16) {
+            __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+               _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+            uint32_t differ = ~static_cast<uint32_t>(_mm_movemask_epi8(eq)) & 0xffff;
+            if(differ) return i + __builtin_ctz(differ);
+         }
+#endif
+         for(; i < n && a[i] == b[i]; i++);
+         return i;
+      }
+
+      // The number of equal bytes at the end of a[0, n) and b[0, n)
+
+      inline size_t mismatch_bytes_reverse(const uint8_t *a, const uint8_t *b, size_t n) {
+         size_t i = 0;
+#if STRINGALGORITHMS_SIMD && defined(__AVX2__)
+         for(; i + 32 <= n; i += 32) {
+            __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + n - i - 32)),
+               _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + n - i - 32)));
+            uint32_t differ = ~static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+            if(differ) return i + __builtin_clz(differ);
+         }
+#elif STRINGALGORITHMS_SIMD
+         for(; i + 16 <= n; i += 16) {
+            __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + n - i - 16)),
+               _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + n - i - 16)));
+            uint32_t differ = (~static_cast<uint32_t>(_mm_movemask_epi8(eq)) & 0xffff) << 16;
+            if(differ) return i + __builtin_clz(differ);
+         }
+#endif
+         for(; i < n && a[n - i - 1] == b[n - i - 1]; i++);
+         return i;
+      }
+
+   } // simd
+
+} // stringAlgorithms
+
+#endif // SIMD_HPP
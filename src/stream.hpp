@@ -0,0 +1,197 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+
+namespace stringAlgorithms {
+
+   // Hirschberg as a stream of columns
+   //
+   // Hirschberg finishes the left half of every split before it starts the right, so the alignment comes out left to
+   // right. Here the recursion is a stack of sub-problems, right halves under left ones, and it is only run as far as
+   // the next column asked for needs: the first column is ready once the splits down the left edge are done, about
+   // two thirds of the work of the whole alignment (the splits cost nm (1 + 1/4 + 1/16 + ...), about 4/3 nm of 2 nm),
+   // and after that the columns come out as the sub-problems are solved. Only the columns of the sub-problem being
+   // handed out are held: at most the cutoff's worth, or x_size + 1 when y_size is 1 and y_size + 1 when x_size is 1,
+   // since those are solved directly whatever the cutoff. A consumer writing them to a file or a socket never needs
+   // the whole alignment in memory. The columns are the ones Hirschberg gives with the same cutoff.
+
+   template<typename I, typename F>
+   class hirschberg_stream {
+   public:
+      typedef typename PP<F, I>::type                       P;
+      typedef typename std::iterator_traits<I>::value_type  T;
+
+      hirschberg_stream(I x_begin, I x_end, I y_begin, I y_end, F score_function, P ID = -1, const T deleted_value = '-',
+         int_fast64_t cutoff = hirschberg_default_cutoff()) :
+         score_function_(score_function), ID_(ID), deleted_value_(deleted_value), workspace_(cutoff),
+         gap_x_(x_begin), gap_x_end_(x_begin), gap_y_(y_begin), gap_y_end_(y_begin)
+      {
+         workspace_.reserve(std::distance(y_begin, y_end));
+         pending_.push_back(problem { x_begin, x_end, y_begin, y_end });
+      }
+
+      // the next column of the alignment, false once they have all been given
+      bool next(T &w, T &z) {
+         if(workspace_.w.empty() && gap_x_ == gap_x_end_ && gap_y_ == gap_y_end_ && !solve_next()) return false;
+
+         if(!workspace_.w.empty()) {
+            w = workspace_.w.back();
+            z = workspace_.z.back();
+            workspace_.w.pop_back();
+            workspace_.z.pop_back();
+         } else if(gap_x_ != gap_x_end_) {
+            w = *gap_x_++;
+            z = deleted_value_;
+         } else {
+            w = deleted_value_;
+            z = *gap_y_++;
+         }
+         return true;
+      }
+
+      // up to n columns written to w_out and z_out, returns the number written, fewer than n only at the end
+      template<typename O>
+      int_fast64_t read(O w_out, O z_out, int_fast64_t n) {
+         int_fast64_t k = 0;
+         T w, z;
+         for(; k < n && next(w, z); k++) {
+            *w_out++ = w;
+            *z_out++ = z;
+         }
+         return k;
+      }
+
+   private:
+      struct problem {
+         I x_begin, x_end, y_begin, y_end;
+      };
+
+      // split sub-problems until one is solved, its columns are left reversed in the workspace or as a run of gaps
+      bool solve_next() {
+         while(!pending_.empty()) {
+            problem p = pending_.back();
+            pending_.pop_back();
+
+            int_fast64_t x_size = std::distance(p.x_begin, p.x_end);
+            int_fast64_t y_size = std::distance(p.y_begin, p.y_end);
+
+            if(x_size == 0 || y_size == 0) {
+               gap_x_ = p.x_begin, gap_x_end_ = p.x_end;
+               gap_y_ = p.y_begin, gap_y_end_ = p.y_end;
+               if(x_size + y_size > 0) return true;
+            } else if(x_size == 1 || y_size == 1 || x_size * y_size <= workspace_.cutoff) {
+               nw_traceback_matrix(p.x_begin, p.x_end, p.y_begin, p.y_end, score_function_, workspace_.moves, ID_, workspace_.row(0),
+                  workspace_.row(1), &workspace_.profile);
+               workspace_.w.clear();
+               workspace_.z.clear();
+               nw_traceback_reversed(workspace_.moves, p.x_begin, p.x_end, p.y_begin, p.y_end, workspace_.w, workspace_.z, deleted_value_);
+               return true;
+            } else {
+               auto x_mid = x_size / 2;
+               auto y_mid = hirschberg_split(p.x_begin, p.x_begin + x_mid, p.x_end, p.y_begin, p.y_end, score_function_, ID_, workspace_);
+               pending_.push_back(problem { p.x_begin + x_mid, p.x_end, p.y_begin + y_mid, p.y_end });
+               pending_.push_back(problem { p.x_begin, p.x_begin + x_mid, p.y_begin, p.y_begin + y_mid });
+            }
+         }
+         return false;
+      }
+
+      F                             score_function_;
+      P                             ID_;
+      T                             deleted_value_;
+      hirschberg_workspace<P, T>    workspace_;
+      std::vector<problem>          pending_;
+      I                             gap_x_, gap_x_end_, gap_y_, gap_y_end_;
+   };
+
+   // A stream of the columns Hirschberg would write for x and y, the iterators must be random access and stay valid
+   // while the stream is read
+
+   template<typename I, typename F>
+   hirschberg_stream<I, typename std::decay<F>::type>
+   make_hirschberg_stream(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-', int_fast64_t cutoff = hirschberg_default_cutoff())
+   {
+      return hirschberg_stream<I, typename std::decay<F>::type>(x_begin, x_end, y_begin, y_end, std::forward<F>(score_function), ID,
+         deleted_value, cutoff);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_stream_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_stream_suite(void)
+   {
+      return 0;
+   }
+
+   void stream_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAAATTCACATCTTTACAG";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGACCAAACATTTAATTCACATCTTACAGAACTTTAGC";
+
+      // the same columns as Hirschberg at every cutoff, read one at a time and in chunks
+      for(int_fast64_t cutoff : { 0, 16, 256, 1 << 20 }) {
+         std::vector<std::string> expected(2, std::string());
+         hirschberg_workspace<int16_t, char> workspace(cutoff);
+         Hirschberg(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected[0]), std::back_inserter(expected[1]),
+            scoring::plus_minus_one, workspace);
+
+         std::vector<std::string> result(2, std::string());
+         auto stream = make_hirschberg_stream(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one, -1, '-', cutoff);
+         char w, z;
+         while(stream.next(w, z)) {
+            result[0].push_back(w);
+            result[1].push_back(z);
+         }
+         CU_ASSERT(result == expected);
+         if(result != expected) {
+            std::cout << std::endl;
+            std::cout << "result[0] = " << result[0] << std::endl;
+            std::cout << "result[1] = " << result[1] << std::endl;
+         }
+         CU_ASSERT(!stream.next(w, z));
+
+         std::string s(7, ' '), t(7, ' ');
+         result.assign(2, std::string());
+         auto chunks = make_hirschberg_stream(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one, -1, '-', cutoff);
+         for(int_fast64_t n; (n = chunks.read(s.begin(), t.begin(), 7)) > 0; ) {
+            result[0].append(s, 0, n);
+            result[1].append(t, 0, n);
+         }
+         CU_ASSERT(result == expected);
+      }
+
+      // one side empty
+      std::string empty, w_all, z_all;
+      auto gaps = make_hirschberg_stream(empty.begin(), empty.end(), y.begin(), y.begin() + 3, scoring::plus_minus_one);
+      char w, z;
+      while(gaps.next(w, z)) w_all.push_back(w), z_all.push_back(z);
+      CU_ASSERT(w_all == "---" && z_all == "ATT");
+      auto nothing = make_hirschberg_stream(empty.begin(), empty.end(), empty.begin(), empty.end(), scoring::plus_minus_one);
+      CU_ASSERT(!nothing.next(w, z));
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // STREAM_HPP
@@ -1,6 +1,14 @@
 #ifndef STRINGUTILITY_HPP
 #define STRINGUTILITY_HPP
 
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
 namespace stringAlgorithms {
 
    namespace scoring {
@@ -21,6 +29,73 @@ namespace stringAlgorithms {
    };
 
 
+   // Whether a score function is a substitution matrix (see substitution.hpp), these give the index of a symbol in
+   // their alphabet with F::index(c) and the score of two indices with F::score_index(i, j) so the engines can build
+   // their lookup tables without calling the score function for every cell
+
+   template<typename F, typename = void>
+   struct is_substitution_matrix : std::false_type {};
+
+   template<typename F>
+   struct is_substitution_matrix<F, typename std::enable_if<(std::decay<F>::type::alphabet_size > 0)>::type> : std::true_type {};
+
+   // F::index() of every byte, built the first time it's asked for
+
+   template<typename F>
+   const int16_t *alphabet_index() {
+      static const struct table {
+         int16_t index[256];
+         table() { for(int c = 0; c < 256; c++) index[c] = F::index(static_cast<char>(c)); }
+      } t;
+      return t.index;
+   }
+
+   // The largest score(a, a) over every element of x and y
+   // this is an upper bound on any score(a, b) for the usual scoring schemes where a match scores at least as well as
+   // a substitution of either element, the banded and early termination engines use it to bound what a path can score
+
+   template<typename I, typename F>
+   typename PP<F, I>::type max_match_score(I x_begin, I x_end, I y_begin, I y_end, F &&score_function)
+   {
+      typedef typename PP<F, I>::type P;
+
+      bool  found = false;
+      P     best = 0;
+      for(auto cur = x_begin; cur != x_end; cur++) {
+         P s = score_function(*cur, *cur);
+         if(!found || s > best) best = s;
+         found = true;
+      }
+      for(auto cur = y_begin; cur != y_end; cur++) {
+         P s = score_function(*cur, *cur);
+         if(!found || s > best) best = s;
+         found = true;
+      }
+      return best;
+   }
+
+   // Whether I walks integers laid out one after another in memory, a pointer or a std::vector or std::string
+   // iterator, so ranges of them can be compared as bytes
+
+   template<typename I, typename T = typename std::remove_cv<typename std::iterator_traits<I>::value_type>::type>
+   struct is_contiguous_integral : std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+      (std::is_pointer<I>::value ||
+       std::is_same<I, typename std::vector<T>::iterator>::value || std::is_same<I, typename std::vector<T>::const_iterator>::value ||
+       std::is_same<I, std::string::iterator>::value || std::is_same<I, std::string::const_iterator>::value)> {};
+
+   // The size of the L2 data cache in bytes, 256KiB if it can't be found
+
+   inline int_fast64_t l2_cache_bytes() {
+      static const int_fast64_t bytes = [] {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+         long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+         if(size > 0) return static_cast<int_fast64_t>(size);
+#endif
+         return static_cast<int_fast64_t>(256 * 1024);
+      }();
+      return bytes;
+   }
+
 } // stringAlgorithms
 
 #endif // STRINGUTILITY_HPP
\ No newline at end of file
@@ -0,0 +1,234 @@
+#ifndef SUBSTITUTION_HPP
+#define SUBSTITUTION_HPP
+
+#include <cstdint>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#include "needlemanwunsch.hpp"
+#include "hirschberg.hpp"
+#endif
+
+#include "stringUtility.hpp"
+
+namespace stringAlgorithms {
+
+   namespace scoring {
+
+      // Substitution matrices
+      //
+      // Each matrix maps a symbol to its index in an alphabet with index(c) and scores two indices with
+      // score_index(i, j), both constexpr so a score can be worked out at compile time with score(a, b). Upper and
+      // lower case symbols are the same and symbols outside the alphabet take the matrix's catch-all index. Called
+      // as a score function they work like any other, but the engines see is_substitution_matrix and build their
+      // profiles from the table rather than calling them for every cell.
+
+      // the position of c in the null terminated alphabet, missing if it isn't there
+      constexpr int alphabet_find(const char *alphabet, char c, int missing, int i = 0) {
+         return alphabet[i] == 0 ? missing : alphabet[i] == c ? i : alphabet_find(alphabet, c, missing, i + 1);
+      }
+
+      constexpr char alphabet_upper(char c) {
+         return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+      }
+
+      template<typename M>
+      struct substitution_matrix {
+         static constexpr int16_t score(char a, char b) {
+            return M::score_index(M::index(a), M::index(b));
+         }
+
+         int16_t operator()(const char &a, const char &b) const {
+            const int16_t *index = alphabet_index<M>();
+            return M::score_index(index[static_cast<unsigned char>(a)], index[static_cast<unsigned char>(b)]);
+         }
+      };
+
+      // Nucleotides scoring Match for the same base and Mismatch otherwise, U is T and anything else (N) mismatches
+      // everything including itself
+
+      template<int16_t Match = 1, int16_t Mismatch = -1>
+      struct dna : substitution_matrix<dna<Match, Mismatch>> {
+         static const int alphabet_size = 5;
+
+         static constexpr int index(char c) {
+            return alphabet_upper(c) == 'U' ? 3 : alphabet_find("ACGT", alphabet_upper(c), 4);
+         }
+
+         static constexpr int16_t score_index(int i, int j) {
+            return i == j && i < 4 ? Match : Mismatch;
+         }
+      };
+
+      // Nucleotides with the IUPAC ambiguity codes, the index is the set of bases a code stands for (A = 1, C = 2,
+      // G = 4, T = 8) and two codes which could be the same base score Match, unknown symbols stand for no base
+
+      template<int16_t Match = 1, int16_t Mismatch = -1>
+      struct iupac : substitution_matrix<iupac<Match, Mismatch>> {
+         static const int alphabet_size = 16;
+
+         // "-ACMGRSVTWYHKDBN" lists the codes in the order of their bit sets
+         static constexpr int index(char c) {
+            return alphabet_upper(c) == 'U' ? 8 : alphabet_find("-ACMGRSVTWYHKDBN", alphabet_upper(c), 0);
+         }
+
+         static constexpr int16_t score_index(int i, int j) {
+            return (i & j) != 0 ? Match : Mismatch;
+         }
+      };
+
+      // The order of the NCBI protein matrices, X is the catch-all and * a stop
+
+      constexpr const char *protein_alphabet() {
+         return "ARNDCQEGHILKMFPSTWYVBZX*";
+      }
+
+      template<typename = void>
+      struct blosum62_values {
+         static constexpr int8_t values[24 * 24] = {
+          // A   R   N   D   C   Q   E   G   H   I   L   K   M   F   P   S   T   W   Y   V   B   Z   X   *
+             4, -1, -2, -2,  0, -1, -1,  0, -2, -1, -1, -1, -1, -2, -1,  1,  0, -3, -2,  0, -2, -1,  0, -4,  // A
+            -1,  5,  0, -2, -3,  1,  0, -2,  0, -3, -2,  2, -1, -3, -2, -1, -1, -3, -2, -3, -1,  0, -1, -4,  // R
+            -2,  0,  6,  1, -3,  0,  0,  0,  1, -3, -3,  0, -2, -3, -2,  1,  0, -4, -2, -3,  3,  0, -1, -4,  // N
+            -2, -2,  1,  6, -3,  0,  2, -1, -1, -3, -4, -1, -3, -3, -1,  0, -1, -4, -3, -3,  4,  1, -1, -4,  // D
+             0, -3, -3, -3,  9, -3, -4, -3, -3, -1, -1, -3, -1, -2, -3, -1, -1, -2, -2, -1, -3, -3, -2, -4,  // C
+            -1,  1,  0,  0, -3,  5,  2, -2,  0, -3, -2,  1,  0, -3, -1,  0, -1, -2, -1, -2,  0,  3, -1, -4,  // Q
+            -1,  0,  0,  2, -4,  2,  5, -2,  0, -3, -3,  1, -2, -3, -1,  0, -1, -3, -2, -2,  1,  4, -1, -4,  // E
+             0, -2,  0, -1, -3, -2, -2,  6, -2, -4, -4, -2, -3, -3, -2,  0, -2, -2, -3, -3, -1, -2, -1, -4,  // G
+            -2,  0,  1, -1, -3,  0,  0, -2,  8, -3, -3, -1, -2, -1, -2, -1, -2, -2,  2, -3,  0,  0, -1, -4,  // H
+            -1, -3, -3, -3, -1, -3, -3, -4, -3,  4,  2, -3,  1,  0, -3, -2, -1, -3, -1,  3, -3, -3, -1, -4,  // I
+            -1, -2, -3, -4, -1, -2, -3, -4, -3,  2,  4, -2,  2,  0, -3, -2, -1, -2, -1,  1, -4, -3, -1, -4,  // L
+            -1,  2,  0, -1, -3,  1,  1, -2, -1, -3, -2,  5, -1, -3, -1,  0, -1, -3, -2, -2,  0,  1, -1, -4,  // K
+            -1, -1, -2, -3, -1,  0, -2, -3, -2,  1,  2, -1,  5,  0, -2, -1, -1, -1, -1,  1, -3, -1, -1, -4,  // M
+            -2, -3, -3, -3, -2, -3, -3, -3, -1,  0,  0, -3,  0,  6, -4, -2, -2,  1,  3, -1, -3, -3, -1, -4,  // F
+            -1, -2, -2, -1, -3, -1, -1, -2, -2, -3, -3, -1, -2, -4,  7, -1, -1, -4, -3, -2, -2, -1, -2, -4,  // P
+             1, -1,  1,  0, -1,  0,  0,  0, -1, -2, -2,  0, -1, -2, -1,  4,  1, -3, -2, -2,  0,  0,  0, -4,  // S
+             0, -1,  0, -1, -1, -1, -1, -2, -2, -1, -1, -1, -1, -2, -1,  1,  5, -2, -2,  0, -1, -1,  0, -4,  // T
+            -3, -3, -4, -4, -2, -2, -3, -2, -2, -3, -2, -3, -1,  1, -4, -3, -2, 11,  2, -3, -4, -3, -2, -4,  // W
+            -2, -2, -2, -3, -2, -1, -2, -3,  2, -1, -1, -2, -1,  3, -3, -2, -2,  2,  7, -1, -3, -2, -1, -4,  // Y
+             0, -3, -3, -3, -1, -2, -2, -3, -3,  3,  1, -2,  1, -1, -2, -2,  0, -3, -1,  4, -3, -2, -1, -4,  // V
+            -2, -1,  3,  4, -3,  0,  1, -1,  0, -3, -4,  0, -3, -3, -2,  0, -1, -4, -3, -3,  4,  1, -1, -4,  // B
+            -1,  0,  0,  1, -3,  3,  4, -2,  0, -3, -3,  1, -1, -3, -1,  0, -1, -3, -2, -2,  1,  4, -1, -4,  // Z
+             0, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -2,  0,  0, -2, -1, -1, -1, -1, -1, -4,  // X
+            -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,  1   // *
+         };
+      };
+
+      template<typename T>
+      constexpr int8_t blosum62_values<T>::values[24 * 24];
+
+      template<typename = void>
+      struct pam250_values {
+         static constexpr int8_t values[24 * 24] = {
+          // A   R   N   D   C   Q   E   G   H   I   L   K   M   F   P   S   T   W   Y   V   B   Z   X   *
+             2, -2,  0,  0, -2,  0,  0,  1, -1, -1, -2, -1, -1, -3,  1,  1,  1, -6, -3,  0,  0,  0,  0, -8,  // A
+            -2,  6,  0, -1, -4,  1, -1, -3,  2, -2, -3,  3,  0, -4,  0,  0, -1,  2, -4, -2, -1,  0, -1, -8,  // R
+             0,  0,  2,  2, -4,  1,  1,  0,  2, -2, -3,  1, -2, -3,  0,  1,  0, -4, -2, -2,  2,  1,  0, -8,  // N
+             0, -1,  2,  4, -5,  2,  3,  1,  1, -2, -4,  0, -3, -6, -1,  0,  0, -7, -4, -2,  3,  3, -1, -8,  // D
+            -2, -4, -4, -5, 12, -5, -5, -3, -3, -2, -6, -5, -5, -4, -3,  0, -2, -8,  0, -2, -4, -5, -3, -8,  // C
+             0,  1,  1,  2, -5,  4,  2, -1,  3, -2, -2,  1, -1, -5,  0, -1, -1, -5, -4, -2,  1,  3, -1, -8,  // Q
+             0, -1,  1,  3, -5,  2,  4,  0,  1, -2, -3,  0, -2, -5, -1,  0,  0, -7, -4, -2,  3,  3, -1, -8,  // E
+             1, -3,  0,  1, -3, -1,  0,  5, -2, -3, -4, -2, -3, -5,  0,  1,  0, -7, -5, -1,  0,  0, -1, -8,  // G
+            -1,  2,  2,  1, -3,  3,  1, -2,  6, -2, -2,  0, -2, -2,  0, -1, -1, -3,  0, -2,  1,  2, -1, -8,  // H
+            -1, -2, -2, -2, -2, -2, -2, -3, -2,  5,  2, -2,  2,  1, -2, -1,  0, -5, -1,  4, -2, -2, -1, -8,  // I
+            -2, -3, -3, -4, -6, -2, -3, -4, -2,  2,  6, -3,  4,  2, -3, -3, -2, -2, -1,  2, -3, -3, -1, -8,  // L
+            -1,  3,  1,  0, -5,  1,  0, -2,  0, -2, -3,  5,  0, -5, -1,  0,  0, -3, -4, -2,  1,  0, -1, -8,  // K
+            -1,  0, -2, -3, -5, -1, -2, -3, -2,  2,  4,  0,  6,  0, -2, -2, -1, -4, -2,  2, -2, -2, -1, -8,  // M
+            -3, -4, -3, -6, -4, -5, -5, -5, -2,  1,  2, -5,  0,  9, -5, -3, -3,  0,  7, -1, -4, -5, -2, -8,  // F
+             1,  0,  0, -1, -3,  0, -1,  0,  0, -2, -3, -1, -2, -5,  6,  1,  0, -6, -5, -1, -1,  0, -1, -8,  // P
+             1,  0,  1,  0,  0, -1,  0,  1, -1, -1, -3,  0, -2, -3,  1,  2,  1, -2, -3, -1,  0,  0,  0, -8,  // S
+             1, -1,  0,  0, -2, -1,  0,  0, -1,  0, -2,  0, -1, -3,  0,  1,  3, -5, -3,  0,  0, -1,  0, -8,  // T
+            -6,  2, -4, -7, -8, -5, -7, -7, -3, -5, -2, -3, -4,  0, -6, -2, -5, 17,  0, -6, -5, -6, -4, -8,  // W
+            -3, -4, -2, -4,  0, -4, -4, -5,  0, -1, -1, -4, -2,  7, -5, -3, -3,  0, 10, -2, -3, -4, -2, -8,  // Y
+             0, -2, -2, -2, -2, -2, -2, -1, -2,  4,  2, -2,  2, -1, -1, -1,  0, -6, -2,  4, -2, -2, -1, -8,  // V
+             0, -1,  2,  3, -4,  1,  3,  0,  1, -2, -3,  1, -2, -4, -1,  0,  0, -5, -3, -2,  3,  2, -1, -8,  // B
+             0,  0,  1,  3, -5,  3,  3,  0,  2, -2, -3,  0, -2, -5,  0,  0, -1, -6, -4, -2,  2,  3, -1, -8,  // Z
+             0, -1,  0, -1, -3, -1, -1, -1, -1, -1, -1, -1, -1, -2, -1,  0,  0, -4, -2, -1, -1, -1, -1, -8,  // X
+            -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8, -8,  1   // *
+         };
+      };
+
+      template<typename T>
+      constexpr int8_t pam250_values<T>::values[24 * 24];
+
+      struct blosum62 : substitution_matrix<blosum62> {
+         static const int alphabet_size = 24;
+
+         static constexpr int index(char c) {
+            return alphabet_find(protein_alphabet(), alphabet_upper(c), 22);
+         }
+
+         static constexpr int16_t score_index(int i, int j) {
+            return blosum62_values<>::values[i * 24 + j];
+         }
+      };
+
+      struct pam250 : substitution_matrix<pam250> {
+         static const int alphabet_size = 24;
+
+         static constexpr int index(char c) {
+            return alphabet_find(protein_alphabet(), alphabet_upper(c), 22);
+         }
+
+         static constexpr int16_t score_index(int i, int j) {
+            return pam250_values<>::values[i * 24 + j];
+         }
+      };
+
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_substitution_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_substitution_suite(void)
+   {
+      return 0;
+   }
+
+   void substitution_test(void)
+   {
+      static_assert(scoring::blosum62::score('W', 'W') == 11 && scoring::blosum62::score('w', 'F') == 1, "BLOSUM62");
+      static_assert(scoring::pam250::score('C', 'C') == 12 && scoring::pam250::score('J', 'A') == 0, "PAM250");
+      static_assert(scoring::iupac<>::score('R', 'A') == 1 && scoring::iupac<>::score('R', 'C') == -1, "IUPAC");
+      static_assert(scoring::dna<2, -3>::score('u', 'T') == 2 && scoring::dna<2, -3>::score('N', 'N') == -3, "DNA");
+
+      bool symmetric = true;
+      for(int i = 0; i < 24; i++) {
+         for(int j = 0; j < 24; j++) {
+            symmetric = symmetric && scoring::blosum62::score_index(i, j) == scoring::blosum62::score_index(j, i)
+               && scoring::pam250::score_index(i, j) == scoring::pam250::score_index(j, i);
+         }
+      }
+      CU_ASSERT(symmetric);
+
+      // the profile built from the table gives the same scores as the generic path through a lambda
+      std::string x = "MKTAYIAKQRQISFVKSHFSRQLEERLGLIEVQAPILSRVGDGTQDNLSGAEKAVQVKVKALPDAQFEVVHSLAKWKRQTLGQHDFSAGEGLYTHMKALRPDEDRLSPLHSVYVDQWDWERVMGDGERQFSTLKSTVEAIWAGIKATEAAVSEEFGLAPFLPDQIHFVHSQELLSRYPDLDAKGRERAIAKDLGAVFLVGIGGKLSDGHRHDVRAPDYDDWSTPSELGHAGLNGDILVWNPVLEDAFELSSMGIRVDADTLKHQLALTGDEDRLELEWHQALLRGEMPQTIGGGIGQSRLTMLLLQLPHIGQVQAGVWPAACRERSFGQ";
+      std::string y = "MKTFFVAGVLAALLPLSQAYSTEVSGTTAIKNSVIGKQGPQHLEQMLEWAAKDDNVRELLIDYSTLADLNRIVKQAVAHTKHGFGGETVPAWQ";
+
+      scoring::blosum62 blosum;
+      auto lambda = [](const char &a, const char &b) -> int16_t { return scoring::blosum62::score(a, b); };
+
+      CU_ASSERT(nwScore(x.begin(), x.end(), y.begin(), y.end(), blosum, -4) == nwScore(x.begin(), x.end(), y.begin(), y.end(), lambda, -4));
+
+      std::vector<std::string> result(2), expected(2);
+      NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]), blosum, -4);
+      NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expected[0]), std::back_inserter(expected[1]), lambda, -4);
+      CU_ASSERT(result == expected);
+      if(result != expected) {
+         std::cout << std::endl;
+         std::cout << "result[0] = " << result[0] << std::endl;
+         std::cout << "result[1] = " << result[1] << std::endl;
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // SUBSTITUTION_HPP
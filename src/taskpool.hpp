@@ -0,0 +1,183 @@
+#ifndef TASKPOOL_HPP
+#define TASKPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stringAlgorithms {
+
+   // A work stealing thread pool
+   //
+   // Every worker has its own deque. Tasks submitted from a worker go on the back of its own deque and it takes
+   // work from the back, idle workers steal from the front of the others. Tasks submitted from outside the pool
+   // go on a shared deque. A pool of n threads starts n - 1 workers, the thread that waits on a task_group
+   // runs tasks too so a pool of 1 runs everything on the calling thread.
+   //
+   // Tasks must not throw.
+
+   class task_pool {
+   public:
+      typedef std::function<void()> task;
+
+      explicit task_pool(unsigned threads = 0) : pending_(0), stop_(false) {
+         if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+         threads_ = threads;
+         for(unsigned i = 0; i < threads; i++) queues_.emplace_back(new queue);
+         for(unsigned i = 1; i < threads; i++) workers_.emplace_back(&task_pool::worker, this, i);
+      }
+
+      ~task_pool() {
+         {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+         }
+         sleep_.notify_all();
+         for(auto &t : workers_) t.join();
+      }
+
+      task_pool(const task_pool &) = delete;
+      task_pool &operator=(const task_pool &) = delete;
+
+      unsigned size() const { return threads_; }
+
+      void submit(task t) {
+         queue &q = *queues_[current()];
+         {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(std::move(t));
+         }
+         {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            pending_++;
+         }
+         sleep_.notify_one();
+      }
+
+      // run one pending task on the calling thread, returns false if there was nothing to run
+      bool run_one() {
+         task t;
+         if(!take(current(), t)) return false;
+         t();
+         return true;
+      }
+
+   private:
+      struct queue {
+         std::mutex        mutex;
+         std::deque<task>  tasks;
+      };
+
+      // the pool and worker index running on this thread
+      struct worker_id {
+         const task_pool   *pool;
+         int               index;
+      };
+
+      static worker_id &self() {
+         static thread_local worker_id id = { nullptr, 0 };
+         return id;
+      }
+
+      // the deque this thread uses, threads outside the pool share the deque at index 0
+      int current() const { return self().pool == this ? self().index : 0; }
+
+      bool take(int self, task &t) {
+         {
+            queue &q = *queues_[self];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if(!q.tasks.empty()) {
+               t = std::move(q.tasks.back());
+               q.tasks.pop_back();
+               return taken();
+            }
+         }
+         for(unsigned k = 1; k < queues_.size(); k++) {
+            queue &q = *queues_[(self + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if(!q.tasks.empty()) {
+               t = std::move(q.tasks.front());
+               q.tasks.pop_front();
+               return taken();
+            }
+         }
+         return false;
+      }
+
+      bool taken() {
+         std::lock_guard<std::mutex> lock(sleep_mutex_);
+         pending_--;
+         return true;
+      }
+
+      void worker(int index) {
+         self().pool = this;
+         self().index = index;
+         task t;
+         for(;;) {
+            if(take(index, t)) {
+               t();
+               t = nullptr;
+               continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_.wait(lock, [this] { return stop_ || pending_ > 0; });
+            if(stop_ && pending_ == 0) return;
+         }
+      }
+
+      unsigned                               threads_;
+      std::vector<std::unique_ptr<queue>>    queues_;
+      std::vector<std::thread>               workers_;
+      std::mutex                             sleep_mutex_;
+      std::condition_variable                sleep_;
+      int_fast64_t                           pending_;
+      bool                                   stop_;
+   };
+
+   // A set of tasks run on a task_pool which can be waited for
+   // wait() runs pending tasks on the calling thread until every task in the group has finished
+
+   class task_group {
+   public:
+      explicit task_group(task_pool &pool) : pool_(pool), outstanding_(0) {}
+
+      ~task_group() { wait(); }
+
+      void run(task_pool::task t) {
+         outstanding_++;
+         pool_.submit([this, t] {
+            t();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(--outstanding_ == 0) done_.notify_all();
+         });
+      }
+
+      void wait() {
+         while(outstanding_ > 0) {
+            if(pool_.run_one()) continue;
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait_for(lock, std::chrono::microseconds(100), [this] { return outstanding_ == 0; });
+         }
+         // the last task may still hold the mutex
+         std::lock_guard<std::mutex> lock(mutex_);
+      }
+
+   private:
+      task_pool                  &pool_;
+      std::atomic<int_fast64_t>  outstanding_;
+      std::mutex                 mutex_;
+      std::condition_variable    done_;
+   };
+
+} // stringAlgorithms
+
+#endif // TASKPOOL_HPP
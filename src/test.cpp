@@ -5,6 +5,25 @@
 #include "needlemanwunsch.hpp"
 #include "hirschberg.hpp"
 #include "lcs.hpp"
+#include "wavefront.hpp"
+#include "parallelhirschberg.hpp"
+#include "banded.hpp"
+#include "score.hpp"
+#include "batch.hpp"
+#include "substitution.hpp"
+#include "affine.hpp"
+#include "local.hpp"
+#include "diff.hpp"
+#include "tokendiff.hpp"
+#include "anchor.hpp"
+#include "checkpoint.hpp"
+#include "align.hpp"
+#include "aligner.hpp"
+#include "stream.hpp"
+#include "cigar.hpp"
+#include "render.hpp"
+#include "fasta.hpp"
+#include "packed.hpp"
 
 #ifdef HAVE_CUNIT_CUNIT_H
    #include <CUnit/Basic.h>
@@ -17,22 +36,104 @@ int main(int argc, char *argv[])
 #ifdef HAVE_CUNIT_CUNIT_H
    CU_pSuite   nw_suite = nullptr,
                hirschberg_suite = nullptr,
-               lcs_suite = nullptr;
+               lcs_suite = nullptr,
+               wavefront_suite = nullptr,
+               parallel_hirschberg_suite = nullptr,
+               banded_suite = nullptr,
+               score_suite = nullptr,
+               batch_suite = nullptr,
+               substitution_suite = nullptr,
+               affine_suite = nullptr,
+               local_suite = nullptr,
+               diff_suite = nullptr,
+               tokendiff_suite = nullptr,
+               anchor_suite = nullptr,
+               checkpoint_suite = nullptr,
+               align_suite = nullptr,
+               aligner_suite = nullptr,
+               stream_suite = nullptr,
+               cigar_suite = nullptr,
+               render_suite = nullptr,
+               fasta_suite = nullptr,
+               packed_suite = nullptr;
 
    if(CUE_SUCCESS != CU_initialize_registry()) goto error1;
 
    if((nw_suite = CU_add_suite("Needleman-Wunsch Suite", init_nw_suite, clean_nw_suite)) == nullptr) goto error1;
 
    if((CU_add_test(nw_suite, "NeedleMan-Wunsch score matrix", nwScoreMatrix_test)) == nullptr) goto error1;
+   if((CU_add_test(nw_suite, "Needleman-Wunsch traceback plane", nw_traceback_plane_test)) == nullptr) goto error1;
    if((CU_add_test(nw_suite, "Needleman-Wunsch", nw_test)) == nullptr) goto error1;
 
    if((hirschberg_suite = CU_add_suite("Hirschberg Suite", init_hirschberg_suite, clean_hirschberg_suite)) == nullptr) goto error1;
    if((CU_add_test(hirschberg_suite, "NeedleMan-Wunsch score row", hirschberg_nwScore_test)) == nullptr) goto error1;
+   if((CU_add_test(hirschberg_suite, "NeedleMan-Wunsch score row SIMD", hirschberg_nwScore_simd_test)) == nullptr) goto error1;
    if((CU_add_test(hirschberg_suite, "Hirschberg", hirschberg_test)) == nullptr) goto error1;
    if((CU_add_test(hirschberg_suite, "Hirschberg 2", hirschberg_2_test)) == nullptr) goto error1;
+   if((CU_add_test(hirschberg_suite, "Hirschberg workspace", hirschberg_workspace_test)) == nullptr) goto error1;
+   if((CU_add_test(hirschberg_suite, "Hirschberg base case cutoff", hirschberg_cutoff_test)) == nullptr) goto error1;
 
    if((lcs_suite = CU_add_suite("Longest Common Subsequence Suite", init_lcs_suite, clean_lcs_suite)) == nullptr) goto error1;
    if((CU_add_test(lcs_suite, "LCS", lcs_test)) == nullptr) goto error1;
+   if((CU_add_test(lcs_suite, "LCS bit-parallel", lcs_bit_parallel_test)) == nullptr) goto error1;
+
+   if((wavefront_suite = CU_add_suite("Wavefront Suite", init_wavefront_suite, clean_wavefront_suite)) == nullptr) goto error1;
+   if((CU_add_test(wavefront_suite, "Parallel Needleman-Wunsch", wavefront_test)) == nullptr) goto error1;
+
+   if((parallel_hirschberg_suite = CU_add_suite("Parallel Hirschberg Suite", init_parallel_hirschberg_suite, clean_parallel_hirschberg_suite)) == nullptr) goto error1;
+   if((CU_add_test(parallel_hirschberg_suite, "Parallel Hirschberg", parallel_hirschberg_test)) == nullptr) goto error1;
+
+   if((banded_suite = CU_add_suite("Banded Suite", init_banded_suite, clean_banded_suite)) == nullptr) goto error1;
+   if((CU_add_test(banded_suite, "Banded Needleman-Wunsch and Hirschberg", banded_test)) == nullptr) goto error1;
+
+   if((score_suite = CU_add_suite("Score Suite", init_score_suite, clean_score_suite)) == nullptr) goto error1;
+   if((CU_add_test(score_suite, "Score only, threshold and X-drop", score_test)) == nullptr) goto error1;
+   if((CU_add_test(score_suite, "Adaptive score width", adaptive_score_test)) == nullptr) goto error1;
+
+   if((batch_suite = CU_add_suite("Batch Suite", init_batch_suite, clean_batch_suite)) == nullptr) goto error1;
+   if((CU_add_test(batch_suite, "Batched Needleman-Wunsch", batch_test)) == nullptr) goto error1;
+
+   if((substitution_suite = CU_add_suite("Substitution Suite", init_substitution_suite, clean_substitution_suite)) == nullptr) goto error1;
+   if((CU_add_test(substitution_suite, "Substitution matrices", substitution_test)) == nullptr) goto error1;
+
+   if((affine_suite = CU_add_suite("Affine Suite", init_affine_suite, clean_affine_suite)) == nullptr) goto error1;
+   if((CU_add_test(affine_suite, "Gotoh and Myers-Miller", affine_test)) == nullptr) goto error1;
+
+   if((local_suite = CU_add_suite("Local Suite", init_local_suite, clean_local_suite)) == nullptr) goto error1;
+   if((CU_add_test(local_suite, "Smith-Waterman and semi-global", local_test)) == nullptr) goto error1;
+
+   if((diff_suite = CU_add_suite("Diff Suite", init_diff_suite, clean_diff_suite)) == nullptr) goto error1;
+   if((CU_add_test(diff_suite, "Myers O(ND) diff", diff_test)) == nullptr) goto error1;
+
+   if((tokendiff_suite = CU_add_suite("Token Diff Suite", init_tokendiff_suite, clean_tokendiff_suite)) == nullptr) goto error1;
+   if((CU_add_test(tokendiff_suite, "Interned line and word diff", tokendiff_test)) == nullptr) goto error1;
+
+   if((anchor_suite = CU_add_suite("Anchor Suite", init_anchor_suite, clean_anchor_suite)) == nullptr) goto error1;
+   if((CU_add_test(anchor_suite, "Exact match anchoring", anchor_test)) == nullptr) goto error1;
+
+   if((checkpoint_suite = CU_add_suite("Checkpoint Suite", init_checkpoint_suite, clean_checkpoint_suite)) == nullptr) goto error1;
+   if((CU_add_test(checkpoint_suite, "Checkpointed Needleman-Wunsch", checkpoint_test)) == nullptr) goto error1;
+
+   if((align_suite = CU_add_suite("Align Suite", init_align_suite, clean_align_suite)) == nullptr) goto error1;
+   if((CU_add_test(align_suite, "Engine selection", align_test)) == nullptr) goto error1;
+
+   if((aligner_suite = CU_add_suite("Aligner Suite", init_aligner_suite, clean_aligner_suite)) == nullptr) goto error1;
+   if((CU_add_test(aligner_suite, "Reusable aligner", aligner_test)) == nullptr) goto error1;
+
+   if((stream_suite = CU_add_suite("Stream Suite", init_stream_suite, clean_stream_suite)) == nullptr) goto error1;
+   if((CU_add_test(stream_suite, "Hirschberg column stream", stream_test)) == nullptr) goto error1;
+
+   if((cigar_suite = CU_add_suite("CIGAR Suite", init_cigar_suite, clean_cigar_suite)) == nullptr) goto error1;
+   if((CU_add_test(cigar_suite, "CIGAR edit scripts", cigar_test)) == nullptr) goto error1;
+
+   if((render_suite = CU_add_suite("Render Suite", init_render_suite, clean_render_suite)) == nullptr) goto error1;
+   if((CU_add_test(render_suite, "Buffered diff rendering", render_test)) == nullptr) goto error1;
+
+   if((fasta_suite = CU_add_suite("FASTA Suite", init_fasta_suite, clean_fasta_suite)) == nullptr) goto error1;
+   if((CU_add_test(fasta_suite, "Mapped FASTA and plain text", fasta_test)) == nullptr) goto error1;
+
+   if((packed_suite = CU_add_suite("Packed Suite", init_packed_suite, clean_packed_suite)) == nullptr) goto error1;
+   if((CU_add_test(packed_suite, "Packed nucleotides and kernels", packed_test)) == nullptr) goto error1;
 
    CU_basic_set_mode(CU_BRM_VERBOSE);
    CU_basic_run_tests();
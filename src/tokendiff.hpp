@@ -0,0 +1,302 @@
+#ifndef TOKENDIFF_HPP
+#define TOKENDIFF_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "diff.hpp"
+
+namespace stringAlgorithms {
+
+   // Diffing lines or words
+   //
+   // Comparing whole tokens in every step is slow, so each distinct token is interned once through a hash table
+   // (token_table) into a dense integer id and the diff runs on the ids. Tokens which occur exactly once in both inputs
+   // are anchors (the patience diff): the longest increasing run of them in both orders is kept as matches and the
+   // pieces between them are diffed independently, recursively anchored in turn, with MyersDiff once no anchors are
+   // left. Anchored diffs follow the unique lines, which keeps large files cheap and the result readable, but they are
+   // not always the shortest script.
+
+   typedef uint32_t token_id;
+
+   const token_id token_deleted = ~token_id(0);
+
+   // Dense ids for distinct tokens and the tokens back from the ids
+   //
+   // Open addressing with linear probing, each slot keeps the hash and the id so most probes never touch a token,
+   // and the table is kept at most half full
+
+   template<typename T, typename H = std::hash<T>>
+   class token_table {
+   public:
+      token_id intern(const T &token)
+      {
+         if(2 * (tokens.size() + 1) > slots.size()) grow();
+
+         size_t hash = hasher(token);
+         size_t i = hash & mask;
+         for(; slots[i].second != token_deleted; i = (i + 1) & mask) {
+            if(slots[i].first == hash && tokens[slots[i].second] == token) return slots[i].second;
+         }
+         slots[i] = std::make_pair(hash, token_id(tokens.size()));
+         tokens.push_back(token);
+         return slots[i].second;
+      }
+
+      template<typename I, typename BI>
+      void intern(I begin, I end, BI &&id_back)
+      {
+         for(; begin != end; begin++) *id_back++ = intern(*begin);
+      }
+
+      const T &token(token_id id) const
+      {
+         return tokens[id];
+      }
+
+      size_t size() const
+      {
+         return tokens.size();
+      }
+
+   private:
+      void grow()
+      {
+         std::vector<std::pair<size_t, token_id>> old(std::max<size_t>(16, 2 * slots.size()), std::make_pair(0, token_deleted));
+         old.swap(slots);
+         mask = slots.size() - 1;
+         for(auto &slot : old) {
+            if(slot.second == token_deleted) continue;
+            size_t i = slot.first & mask;
+            while(slots[i].second != token_deleted) i = (i + 1) & mask;
+            slots[i] = slot;
+         }
+      }
+
+      std::vector<std::pair<size_t, token_id>>  slots;
+      std::vector<T>                            tokens;
+      size_t                                    mask = 0;
+      H                                         hasher;
+   };
+
+   // The lines of text without their line ends, a last line end doesn't start another line
+
+   inline std::vector<std::string> split_lines(const std::string &text)
+   {
+      std::vector<std::string> lines;
+      size_t begin = 0;
+      while(begin < text.size()) {
+         size_t end = text.find('\n', begin);
+         if(end == std::string::npos) end = text.size();
+         size_t content_end = end > begin && text[end - 1] == '\r' ? end - 1 : end;
+         lines.emplace_back(text, begin, content_end - begin);
+         begin = end + 1;
+      }
+      return lines;
+   }
+
+   // The words of text between whitespace
+
+   inline std::vector<std::string> split_words(const std::string &text)
+   {
+      std::vector<std::string> words;
+      size_t i = 0;
+      while(i < text.size()) {
+         while(i < text.size() && std::isspace((unsigned char)text[i])) i++;
+         size_t begin = i;
+         while(i < text.size() && !std::isspace((unsigned char)text[i])) i++;
+         if(i > begin) words.emplace_back(text, begin, i - begin);
+      }
+      return words;
+   }
+
+   // Counts and positions of the ids in the piece being anchored, indexed by id and cleared after every piece
+
+   struct patience_workspace {
+      std::vector<int_fast64_t>  x_count, y_count, x_position, y_position;
+      std::vector<int_fast64_t>  tails, previous;
+      myers_workspace            myers;
+
+      explicit patience_workspace(size_t ids) :
+         x_count(ids, 0), y_count(ids, 0), x_position(ids), y_position(ids) {}
+   };
+
+   // The unique anchors of x and y as (x offset, y offset) pairs, increasing in both
+
+   inline std::vector<std::pair<int_fast64_t, int_fast64_t>>
+   patience_anchors(const token_id *x, int_fast64_t x_size, const token_id *y, int_fast64_t y_size, patience_workspace &workspace)
+   {
+      for(int_fast64_t i = 0; i < x_size; i++) workspace.x_count[x[i]]++, workspace.x_position[x[i]] = i;
+      for(int_fast64_t j = 0; j < y_size; j++) workspace.y_count[y[j]]++, workspace.y_position[y[j]] = j;
+
+      std::vector<std::pair<int_fast64_t, int_fast64_t>> unique;
+      for(int_fast64_t i = 0; i < x_size; i++) {
+         if(workspace.x_count[x[i]] == 1 && workspace.y_count[x[i]] == 1) unique.emplace_back(i, workspace.y_position[x[i]]);
+      }
+
+      for(int_fast64_t i = 0; i < x_size; i++) workspace.x_count[x[i]] = 0;
+      for(int_fast64_t j = 0; j < y_size; j++) workspace.y_count[y[j]] = 0;
+
+      // longest increasing run of the y offsets, patience sorting
+      std::vector<int_fast64_t> &tails = workspace.tails, &previous = workspace.previous;
+      tails.clear();
+      previous.assign(unique.size(), -1);
+      for(size_t k = 0; k < unique.size(); k++) {
+         auto pile = std::lower_bound(tails.begin(), tails.end(), unique[k].second,
+            [&unique](int_fast64_t t, int_fast64_t y_offset) { return unique[t].second < y_offset; });
+         if(pile != tails.begin()) previous[k] = *(pile - 1);
+         if(pile == tails.end()) tails.push_back(k);
+         else *pile = k;
+      }
+
+      std::vector<std::pair<int_fast64_t, int_fast64_t>> anchors(tails.size());
+      int_fast64_t k = tails.empty() ? -1 : tails.back();
+      for(auto a = anchors.rbegin(); a != anchors.rend(); a++, k = previous[k]) *a = unique[k];
+      return anchors;
+   }
+
+   // Pieces nested deeper than this are left to MyersDiff, a run of single anchors would otherwise recurse once per token
+
+   const int patience_max_depth = 64;
+
+   // Write the anchored diff of the ids x and y padded with token_deleted, returns the number of edits
+
+   template<typename BI>
+   int_fast64_t patience_step(const token_id *x, int_fast64_t x_size, const token_id *y, int_fast64_t y_size, BI &w_back, BI &z_back,
+      patience_workspace &workspace, int depth = 0)
+   {
+      // the common prefix and suffix first, they often hold all the anchors
+      int_fast64_t prefix = 0, suffix = 0;
+      while(prefix < x_size && prefix < y_size && x[prefix] == y[prefix]) prefix++;
+      while(suffix < x_size - prefix && suffix < y_size - prefix && x[x_size - suffix - 1] == y[y_size - suffix - 1]) suffix++;
+
+      for(int_fast64_t i = 0; i < prefix; i++) *w_back++ = x[i], *z_back++ = y[i];
+
+      const token_id *x_middle = x + prefix, *y_middle = y + prefix;
+      int_fast64_t x_middle_size = x_size - prefix - suffix, y_middle_size = y_size - prefix - suffix;
+      int_fast64_t edits = 0;
+
+      auto anchors = x_middle_size && y_middle_size && depth < patience_max_depth ?
+         patience_anchors(x_middle, x_middle_size, y_middle, y_middle_size, workspace) : std::vector<std::pair<int_fast64_t, int_fast64_t>>();
+
+      if(anchors.empty()) {
+         edits = myers_step(x_middle, x_middle + x_middle_size, y_middle, y_middle + y_middle_size, w_back, z_back, token_deleted,
+            workspace.myers);
+      } else {
+         int_fast64_t i = 0, j = 0;
+         for(auto &anchor : anchors) {
+            edits += patience_step(x_middle + i, anchor.first - i, y_middle + j, anchor.second - j, w_back, z_back, workspace, depth + 1);
+            *w_back++ = x_middle[anchor.first];
+            *z_back++ = y_middle[anchor.second];
+            i = anchor.first + 1;
+            j = anchor.second + 1;
+         }
+         edits += patience_step(x_middle + i, x_middle_size - i, y_middle + j, y_middle_size - j, w_back, z_back, workspace, depth + 1);
+      }
+
+      for(int_fast64_t i = x_size - suffix, j = y_size - suffix; i < x_size; i++, j++) *w_back++ = x[i], *z_back++ = y[j];
+      return edits;
+   }
+
+   // The anchored diff of the interned sequences x and y, ids below ids, padded with token_deleted
+
+   template<typename BI>
+   int_fast64_t patience_diff(const std::vector<token_id> &x, const std::vector<token_id> &y, size_t ids, BI &&w_back, BI &&z_back)
+   {
+      patience_workspace workspace(ids);
+      return patience_step(x.data(), x.size(), y.data(), y.size(), w_back, z_back, workspace);
+   }
+
+   // The diff of two token sequences, such as the lines or words of two files, written to w_back and z_back in the
+   // padded form NeedlemanWunsch() writes with deleted_value for the gaps. Returns the number of edits
+   // deleted_value has no default, it must not be a token and T() is often one, the empty line from split_lines()
+
+   template<typename I, typename BI>
+   int_fast64_t TokenDiff(I x_begin, I x_end, I y_begin, I y_end, BI &&w_back, BI &&z_back,
+      const typename std::iterator_traits<I>::value_type deleted_value)
+   {
+      typedef typename std::iterator_traits<I>::value_type T;
+
+      token_table<T> table;
+      std::vector<token_id> x, y, w, z;
+      table.intern(x_begin, x_end, std::back_inserter(x));
+      table.intern(y_begin, y_end, std::back_inserter(y));
+
+      int_fast64_t edits = patience_diff(x, y, table.size(), std::back_inserter(w), std::back_inserter(z));
+
+      for(size_t i = 0; i < w.size(); i++) {
+         *w_back++ = w[i] == token_deleted ? deleted_value : table.token(w[i]);
+         *z_back++ = z[i] == token_deleted ? deleted_value : table.token(z[i]);
+      }
+      return edits;
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_tokendiff_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_tokendiff_suite(void)
+   {
+      return 0;
+   }
+
+   void tokendiff_test(void)
+   {
+      std::vector<std::string> lines = split_lines("a\r\nb\n\nc\n");
+      CU_ASSERT((lines == std::vector<std::string>{ "a", "b", "", "c" }));
+      CU_ASSERT((split_words("  one two\tthree\n") == std::vector<std::string>{ "one", "two", "three" }));
+
+      token_table<std::string> table;
+      CU_ASSERT(table.intern("x") == 0 && table.intern("y") == 1 && table.intern("x") == 0 && table.size() == 2);
+      CU_ASSERT(table.token(1) == "y");
+
+      // a function moved below another, the unique lines keep the bodies together where the shortest script
+      // would match the braces
+      std::vector<std::string> x = split_lines("void f()\n{\n   f_body();\n}\n\nvoid g()\n{\n   g_body();\n}\n");
+      std::vector<std::string> y = split_lines("void g()\n{\n   g_body();\n}\n\nvoid f()\n{\n   f_body();\n}\n");
+
+      std::vector<std::string> w, z;
+      int_fast64_t edits = TokenDiff(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(w), std::back_inserter(z),
+         std::string("\x01"));
+
+      // the padding removed gives x and y back and the matched lines are equal
+      std::vector<std::string> x_back, y_back;
+      int_fast64_t gaps = 0;
+      bool aligned = w.size() == z.size();
+      for(size_t i = 0; aligned && i < w.size(); i++) {
+         if(w[i] != "\x01") x_back.push_back(w[i]);
+         if(z[i] != "\x01") y_back.push_back(z[i]);
+         if(w[i] == "\x01" || z[i] == "\x01") gaps++;
+         else aligned = w[i] == z[i];
+      }
+      CU_ASSERT(aligned && x_back == x && y_back == y && gaps == edits);
+      CU_ASSERT(edits == 10 && w[5] == "void g()" && z[5] == "void g()");
+      if(!aligned || edits != 10) {
+         std::cout << std::endl;
+         for(size_t i = 0; i < w.size() && i < z.size(); i++) std::cout << w[i] << " | " << z[i] << std::endl;
+      }
+
+      // nothing unique, the ids are diffed by MyersDiff
+      std::vector<token_id> a = { 0, 1, 0, 1, 0 }, b = { 1, 0, 1, 0 }, s, t;
+      CU_ASSERT(patience_diff(a, b, 2, std::back_inserter(s), std::back_inserter(t)) == 1);
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // TOKENDIFF_HPP
@@ -0,0 +1,258 @@
+#ifndef WAVEFRONT_HPP
+#define WAVEFRONT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#ifdef HAVE_CUNIT_CUNIT_H
+#include "stringoutput.hpp"
+#include <CUnit/Basic.h>
+#endif
+
+#include "stringUtility.hpp"
+#include "needlemanwunsch.hpp"
+#include "taskpool.hpp"
+
+namespace stringAlgorithms {
+
+   // Multithreaded full matrix Needleman-Wunsch
+   //
+   // The score matrix is cut into tile x tile blocks. A block can be computed once the blocks above it and to its
+   // left are done so the blocks run as an anti-diagonal wavefront across a task_pool. The results are the same as
+   // the serial functions. The score function is called from several threads at once.
+   //
+   // Along each axis tile b owns the indices [max(1, b * tile), min((b + 1) * tile, size + 1)), row and column 0
+   // are filled before the wavefront starts. tile is rounded down to a multiple of 4 so that no two blocks share
+   // a byte of the traceback_plane.
+
+   inline int_fast64_t wavefront_tile_size(int_fast64_t tile) {
+      return std::max<int_fast64_t>(4, tile & ~int_fast64_t(3));
+   }
+
+   inline int_fast64_t wavefront_tiles(int_fast64_t size, int_fast64_t tile) {
+      return (size + tile) / tile;
+   }
+
+   // Run tile(bi, bj) for every block of a tile_rows x tile_cols grid, each block starts once the blocks above and
+   // to the left of it have finished
+
+   template<typename T>
+   void wavefront(task_pool &pool, int_fast64_t tile_rows, int_fast64_t tile_cols, T &tile)
+   {
+      std::unique_ptr<std::atomic<int>[]> waiting(new std::atomic<int>[tile_rows * tile_cols]);
+      for(int_fast64_t bi = 0; bi < tile_rows; bi++) {
+         for(int_fast64_t bj = 0; bj < tile_cols; bj++) waiting[bi * tile_cols + bj] = (bi > 0) + (bj > 0);
+      }
+
+      task_group group(pool);
+
+      std::function<void(int_fast64_t, int_fast64_t)> start = [&](int_fast64_t bi, int_fast64_t bj) {
+         group.run([&, bi, bj] {
+            tile(bi, bj);
+            if(bi + 1 < tile_rows && --waiting[(bi + 1) * tile_cols + bj] == 0) start(bi + 1, bj);
+            if(bj + 1 < tile_cols && --waiting[bi * tile_cols + bj + 1] == 0) start(bi, bj + 1);
+         });
+      };
+
+      start(0, 0);
+      group.wait();
+   }
+
+   // nw_flat_score_matrix() computed by a wavefront of threads, threads = 0 uses every core
+
+   template<typename I, typename F>
+   flat_matrix<typename PP<F, I>::type>
+   nw_flat_score_matrix_parallel(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, typename PP<F, I>::type ID = -1,
+      unsigned threads = 0, int_fast64_t tile = 256)
+   {
+      typedef typename PP<F,I>::type P;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      tile = wavefront_tile_size(tile);
+
+      flat_matrix<P> score(x_size + 1, y_size + 1);
+
+      score(0, 0) = 0;
+      for(int_fast64_t j = 1; j <= y_size; j++) score(0, j) = score(0, j-1) + ID;
+      for(int_fast64_t i = 1; i <= x_size; i++) score(i, 0) = score(i-1, 0) + ID;
+
+      if(x_size == 0 || y_size == 0) return score;
+
+      auto fill = [&](int_fast64_t bi, int_fast64_t bj) {
+         int_fast64_t i0 = std::max<int_fast64_t>(1, bi * tile), i1 = std::min((bi + 1) * tile, x_size + 1);
+         int_fast64_t j0 = std::max<int_fast64_t>(1, bj * tile), j1 = std::min((bj + 1) * tile, y_size + 1);
+
+         auto x_cur = std::next(x_begin, i0 - 1);
+         auto y_tile = std::next(y_begin, j0 - 1);
+         for(int_fast64_t i = i0; i < i1; i++) {
+            const P *top = score.row(i-1);
+            P *bottom = score.row(i);
+            auto y_cur = y_tile;
+            for(int_fast64_t j = j0; j < j1; j++) {
+               P score_sub = top[j-1] + score_function(*x_cur, *y_cur);
+               P score_del = top[j] + ID;
+               P score_ins = bottom[j-1] + ID;
+               bottom[j] = std::max({score_sub, score_del, score_ins});
+               y_cur++;
+            }
+            x_cur++;
+         }
+      };
+
+      task_pool pool(threads);
+      wavefront(pool, wavefront_tiles(x_size, tile), wavefront_tiles(y_size, tile), fill);
+
+      return score;
+   }
+
+   // nw_traceback_matrix() computed by a wavefront of threads, threads = 0 uses every core
+   // besides the traceback_plane only the last row and column of each block is kept
+
+   template<typename I, typename F>
+   typename PP<F, I>::type
+   nw_traceback_matrix_parallel(I x_begin, I x_end, I y_begin, I y_end, F &&score_function, traceback_plane &moves,
+      typename PP<F, I>::type ID = -1, unsigned threads = 0, int_fast64_t tile = 256)
+   {
+      typedef typename PP<F,I>::type P;
+
+      int_fast64_t x_size = std::distance(x_begin, x_end);
+      int_fast64_t y_size = std::distance(y_begin, y_end);
+
+      if(x_size == 0 || y_size == 0) return nw_traceback_matrix(x_begin, x_end, y_begin, y_end, score_function, moves, ID);
+
+      tile = wavefront_tile_size(tile);
+
+      int_fast64_t tile_rows = wavefront_tiles(x_size, tile);
+      int_fast64_t tile_cols = wavefront_tiles(y_size, tile);
+
+      moves.resize(x_size + 1, y_size + 1);
+
+      // row_edge row b is the row of scores above block row b, col_edge row b is the column left of block column b
+
+      flat_matrix<P> row_edge(tile_rows, y_size + 1);
+      flat_matrix<P> col_edge(tile_cols, x_size + 1);
+
+      traceback_plane::set(moves.row(0), 0, NW_DIAG);
+      for(int_fast64_t j = 1; j <= y_size; j++) {
+         row_edge(0, j) = row_edge(0, j-1) + ID;
+         traceback_plane::set(moves.row(0), j, NW_LEFT);
+      }
+      for(int_fast64_t i = 1; i <= x_size; i++) {
+         col_edge(0, i) = col_edge(0, i-1) + ID;
+         traceback_plane::set(moves.row(i), 0, NW_UP);
+      }
+      for(int_fast64_t bi = 1; bi < tile_rows; bi++) row_edge(bi, 0) = col_edge(0, bi * tile - 1);
+
+      P result = 0;
+
+      auto fill = [&](int_fast64_t bi, int_fast64_t bj) {
+         int_fast64_t i0 = std::max<int_fast64_t>(1, bi * tile), i1 = std::min((bi + 1) * tile, x_size + 1);
+         int_fast64_t j0 = std::max<int_fast64_t>(1, bj * tile), j1 = std::min((bj + 1) * tile, y_size + 1);
+         int_fast64_t w = j1 - j0;
+
+         std::vector<P> top(row_edge.row(bi) + j0 - 1, row_edge.row(bi) + j1);
+         std::vector<P> bottom(w + 1);
+
+         auto x_cur = std::next(x_begin, i0 - 1);
+         auto y_tile = std::next(y_begin, j0 - 1);
+         for(int_fast64_t i = i0; i < i1; i++) {
+            uint8_t *move_row = moves.row(i);
+            bottom[0] = col_edge(bj, i);
+            auto y_cur = y_tile;
+            for(int_fast64_t k = 1; k <= w; k++) {
+               P score_sub = top[k-1] + score_function(*x_cur, *y_cur);
+               P score_del = top[k] + ID;
+               P score_ins = bottom[k-1] + ID;
+               if(score_sub >= score_del && score_sub >= score_ins) {
+                  bottom[k] = score_sub;
+                  traceback_plane::set(move_row, j0 + k - 1, NW_DIAG);
+               } else if(score_del >= score_ins) {
+                  bottom[k] = score_del;
+                  traceback_plane::set(move_row, j0 + k - 1, NW_UP);
+               } else {
+                  bottom[k] = score_ins;
+                  traceback_plane::set(move_row, j0 + k - 1, NW_LEFT);
+               }
+               y_cur++;
+            }
+            if(bj + 1 < tile_cols) col_edge(bj + 1, i) = bottom[w];
+            x_cur++;
+            std::swap(top, bottom);
+         }
+         if(bi + 1 < tile_rows) std::copy(top.begin() + 1, top.end(), row_edge.row(bi + 1) + j0);
+         if(bi + 1 == tile_rows && bj + 1 == tile_cols) result = top[w];
+      };
+
+      task_pool pool(threads);
+      wavefront(pool, tile_rows, tile_cols, fill);
+
+      return result;
+   }
+
+   // NeedlemanWunsch with the traceback plane filled by a wavefront of threads, threads = 0 uses every core
+
+   template<typename I, typename BI, typename F>
+   void ParallelNeedlemanWunsch(I x_begin, I x_end, I y_begin, I y_end, BI w_back, BI z_back, F &&score_function, typename PP<F, I>::type ID = -1,
+      const typename std::iterator_traits<I>::value_type deleted_value = '-', unsigned threads = 0, int_fast64_t tile = 256)
+   {
+      traceback_plane moves;
+      nw_traceback_matrix_parallel(x_begin, x_end, y_begin, y_end, std::forward<F>(score_function), moves, ID, threads, tile);
+      nw_traceback(moves, x_begin, x_end, y_begin, y_end, w_back, z_back, deleted_value);
+   }
+
+#ifdef HAVE_CUNIT_CUNIT_H
+
+   int init_wavefront_suite(void)
+   {
+      return 0;
+   }
+
+   int clean_wavefront_suite(void)
+   {
+      return 0;
+   }
+
+   void wavefront_test(void)
+   {
+      std::string x = "GAATTTATGCTTATAGTTTAAATCCTTTCCTCTGGTCTCCCTTTGAATCATTATGTGAAATAGGTGAAAAGCC";
+      std::string y = "ATTCCTGCTTACCGTTTAAATCCTTTCCTCTGGTCTCCCTTGAATCATTATGTGAAATAGGTGAAAAGCCAGATCCTGA";
+
+      // small tiles so there are many blocks and partial blocks on both edges
+      auto serial = nw_flat_score_matrix(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one);
+      auto parallel = nw_flat_score_matrix_parallel(x.begin(), x.end(), y.begin(), y.end(), scoring::plus_minus_one, -1, 4, 8);
+
+      bool same = true;
+      for(int_fast64_t i = 0; i < serial.rows(); i++) {
+         for(int_fast64_t j = 0; j < serial.cols(); j++) same = same && serial(i, j) == parallel(i, j);
+      }
+      CU_ASSERT(same);
+
+      std::vector<std::string> expectedResult(2, std::string());
+      std::vector<std::string> result(2, std::string());
+
+      NeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(expectedResult[0]), std::back_inserter(expectedResult[1]),
+         scoring::plus_minus_one);
+      ParallelNeedlemanWunsch(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result[0]), std::back_inserter(result[1]),
+         scoring::plus_minus_one, -1, '-', 4, 12);
+
+      CU_ASSERT(result == expectedResult);
+      if(result != expectedResult) {
+         std::cout << std::endl;
+         std::cout << "result[0] = " << result[0] << std::endl;
+         std::cout << "result[1] = " << result[1] << std::endl;
+      }
+      return;
+   }
+
+#endif // HAVE_CUNIT_CUNIT_H
+
+} // stringAlgorithms
+
+#endif // WAVEFRONT_HPP